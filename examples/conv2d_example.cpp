@@ -0,0 +1,62 @@
+#include <getopt.h>
+#include <chrono>
+
+#include "conv2d.hpp"
+
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename = "examples/edwige_512.ppm";
+  double sigma = 2;
+  double amount = 0;
+  Conv2DMethod method = Conv2DMethod::automatic;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:s:u:m:h")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 's':
+        sigma = atof(optarg);
+        continue;
+      case 'u':
+        amount = atof(optarg);
+        continue;
+      case 'm':
+        if(std::string(optarg) == "direct")
+          method = Conv2DMethod::direct;
+        else if(std::string(optarg) == "fft")
+          method = Conv2DMethod::fft;
+        continue;
+      case 'h':
+      default :
+        printf("Usage: conv2d_example [-f file.ppm|file.pgm] [-s sigma] [-u unsharp-amount] [-m auto|direct|fft]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
+  }
+
+  netpbm img;
+  img.decoder(filename);
+
+  // Gaussian blur, or unsharp masking with -u
+  size_t size = gaussian_size(sigma);
+  std::vector<float> kernel = (amount > 0) ? unsharp_kernel<float>(sigma, amount) : gaussian_kernel<float>(sigma);
+  Convolver2D<float> conv(kernel, size, size, false, method);
+
+  auto start = std::chrono::steady_clock::now();
+  netpbm out = convolve(img, conv);
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+
+  std::cout << size << " x " << size << " kernel, " << (conv.uses_fft() ? "FFT tiles of " + std::to_string(conv.get_tile()) : std::string("direct"))
+            << ": " << seconds * 1e3 << " ms (" << img.get_width() * img.get_height() / seconds / 1e6 << " MP/s)" << std::endl;
+
+  std::string filename_clean = filename.substr(0, filename.size() - 4);
+  out.encoder(filename_clean + ((amount > 0) ? "_sharp" : "_blur"), img.is_rgb() ? "ppm" : "pgm");
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <getopt.h>
+#include <chrono>
+#include <fstream>
+
+#include "dctcodec.hpp"
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double psnr(const netpbm& a, const netpbm& b) {
+  double mse = 0;
+  for(size_t i=0; i<a.get_bytes(); i++)
+    mse += ((double)a.data()[i] - b.data()[i]) * ((double)a.data()[i] - b.data()[i]);
+  mse /= a.get_bytes();
+  return 10 * std::log10((double)a.get_max() * a.get_max() / mse);
+}
+
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename = "examples/edwige_512.ppm";
+  size_t quality = 75;
+  size_t threads = 0;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:q:t:h")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 'q':
+        quality = atoi(optarg);
+        continue;
+      case 't':
+        threads = atoi(optarg);
+        continue;
+      case 'h':
+      default :
+        printf("Usage: dctcodec_example [-f file.ppm|file.pgm] [-q quality] [-t threads]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
+  }
+
+  std::string ext = filename.substr(filename.size() - 3);
+  std::string filename_clean = filename.substr(0, filename.size() - 4);
+
+  netpbm img;
+  img.decoder(filename);
+  size_t pixels = (size_t)img.get_width() * img.get_height();
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> packed = dct_encode(img, quality, threads);
+  double t_enc = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  netpbm out = dct_decode(packed.data(), packed.size(), threads);
+  double t_dec = seconds_since(start);
+
+  std::cout << img.get_width() << " x " << img.get_height() << ", quality " << quality << ": " << img.get_bytes() << " -> " << packed.size() << " bytes ("
+            << 8.0 * packed.size() / pixels << " bits per pixel), " << psnr(img, out) << " dB" << std::endl;
+  std::cout << "Encode: " << pixels / t_enc / 1e6 << " MP/s, decode: " << pixels / t_dec / 1e6 << " MP/s on " << num_threads(threads) << " threads" << std::endl;
+
+  std::ofstream fs(filename_clean + ".dct", std::ios::binary);
+  fs.write((const char*)packed.data(), packed.size());
+  out.encoder(filename_clean + "_dct", ext);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <getopt.h>
+#include <chrono>
+
+#include "dwt.hpp"
+#include "dct.hpp"
+#include "netpbm.hpp"
+#include "wav.hpp"
+
+// Zero all but the given share of the coefficients, the largest ones
+void keep_largest(std::vector<float>& x, double share) {
+  std::vector<float> mag(x.size());
+  for(size_t i=0; i<x.size(); i++)
+    mag[i] = std::abs(x[i]);
+  size_t kept = std::clamp<size_t>(share * x.size(), 1, x.size());
+  std::nth_element(mag.begin(), mag.begin() + (x.size() - kept), mag.end());
+  float threshold = mag[x.size() - kept];
+  for(auto& v : x)
+    if(std::abs(v) < threshold)
+      v = 0;
+}
+
+double psnr(const std::vector<float>& x, const std::vector<float>& y, double peak) {
+  double mse = 0;
+  for(size_t i=0; i<x.size(); i++)
+    mse += (x[i] - y[i]) * (x[i] - y[i]);
+  mse /= x.size();
+  return 10 * std::log10(peak * peak / mse);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename = "examples/edwige_512.ppm";
+  Wavelet w = Wavelet::cdf97;
+  size_t levels = 4;
+  double share = 0.05;
+  bool bench = false;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:w:l:k:bh")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 'w':
+        if(std::string(optarg) == "haar")
+          w = Wavelet::haar;
+        else if(std::string(optarg) == "cdf53")
+          w = Wavelet::cdf53;
+        continue;
+      case 'l':
+        levels = atoi(optarg);
+        continue;
+      case 'k':
+        share = atof(optarg) / 100;
+        continue;
+      case 'b':
+        bench = true;
+        continue;
+      case 'h':
+      default :
+        printf("Usage: dwt_example [-f file.ppm|file.pgm|file.wav] [-w cdf97|cdf53|haar] [-l levels] [-k kept-percent] [-b]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
+  }
+
+  std::string ext = filename.substr(filename.size() - 3);
+  std::string filename_clean = filename.substr(0, filename.size() - 4);
+
+  // Audio: first channel of a WAV file
+  if(ext == "wav") {
+    WavMap wav(filename);
+    size_t n = wav.num_frames();
+    size_t channels = wav.get_header().num_channels;
+    std::vector<std::vector<float>> planes(channels, std::vector<float>(n));
+    std::vector<float*> out(channels);
+    for(size_t c=0; c<channels; c++)
+      out[c] = planes[c].data();
+    // Samples in [-1, 1]
+    wav.read_planar(0, n, out.data(), 1 / pcm_full_scale(wav_pcm_format(wav.get_header())));
+
+    std::vector<float> x = planes[0];
+    auto start = std::chrono::steady_clock::now();
+    dwt(x, w, levels);
+    double t = seconds_since(start);
+    keep_largest(x, share);
+    idwt(x, w, levels);
+    std::cout << n << " samples, " << levels << " levels: " << t * 1e3 << " ms (" << n / t / 1e6 << " MS/s), "
+              << share * 100 << "% of the coefficients: " << psnr(planes[0], x, 1) << " dB" << std::endl;
+    return 0;
+  }
+
+  // Image: each channel of a grayscale or RGB image
+  netpbm img;
+  img.decoder(filename);
+  if(img.is_baw()) {
+    std::cout << "Only grayscale and RGB images are supported." << std::endl;
+    exit(1);
+  }
+  size_t width = img.get_width();
+  size_t height = img.get_height();
+  size_t n = width * height;
+  size_t channels = img.is_rgb() ? 3 : 1;
+
+  std::vector<uint8_t> raster(img.get_bytes());
+  std::vector<float> plane(n);
+  std::vector<float> x(n);
+  double t = 0;
+  double quality = 0;
+  for(size_t ch=0; ch<channels; ch++) {
+    raster_to_plane(img.data(), n, channels, ch, img.get_depth(), plane.data());
+    x = plane;
+    auto start = std::chrono::steady_clock::now();
+    dwt_2D(x.data(), height, width, width, w, levels);
+    t += seconds_since(start);
+    keep_largest(x, share);
+    idwt_2D(x.data(), height, width, width, w, levels);
+    quality += psnr(plane, x, img.get_max()) / channels;
+    plane_to_raster(x.data(), n, channels, ch, img.get_depth(), img.get_max(), raster.data());
+  }
+  std::cout << width << " x " << height << ", " << levels << " levels: " << t * 1e3 << " ms (" << n * channels / t / 1e6 << " MP/s), "
+            << share * 100 << "% of the coefficients: " << quality << " dB" << std::endl;
+
+  netpbm out(img.is_rgb() ? "P6" : "P5", width, height, img.get_max(), raster.data());
+  out.encoder(filename_clean + "_dwt", img.is_rgb() ? "ppm" : "pgm");
+
+  // Same image through 8 x 8 DCT blocks, as in JPEG
+  if(bench) {
+    x = plane;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t ch=0; ch<channels; ch++)
+      for(size_t r=0; r+8<=height; r+=8)
+        for(size_t c=0; c+8<=width; c+=8)
+          dctII_2D(x.data() + r*width + c, 8, 8, width);
+    t = seconds_since(start);
+    std::cout << "8 x 8 DCT blocks: " << t * 1e3 << " ms (" << n * channels / t / 1e6 << " MP/s)" << std::endl;
+  }
+
+  return 0;
+}
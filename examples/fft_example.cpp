@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "fft.hpp"
 #include "wav.hpp"
 #include "window.hpp"
@@ -1,20 +1,32 @@
 #include <getopt.h>
+#include <chrono>
+#include <algorithm>
 
 #include "hadamard.hpp"
 
 int main(int argc, char** argv) {
   // Default value
   size_t N = 1024;
+  size_t count = 1;
+  bool bench = false;
+  size_t total_rep = 1;
 
   // Read options
   for(;;) {
-    switch(getopt(argc, argv, "n:")) {
+    switch(getopt(argc, argv, "n:c:bh")) {
       case 'n':
         N = atoi(optarg);
         continue;
+      case 'c':
+        count = atoi(optarg);
+        continue;
+      case 'b':
+        bench = true;
+        total_rep = 99;
+        continue;
       case 'h':
       default :
-        printf("Usage: hadamard_example [-n size]\n");
+        printf("Usage: hadamard_example [-n size] [-c batch-count] [-b]\n");
         return 0;
         break;
       case -1:
@@ -34,13 +46,30 @@ int main(int argc, char** argv) {
   }
 
   // Initialize input
-  std::vector<double> x(N);
-  for(size_t i=0; i<N; i++) {
+  std::vector<double> x(N * count);
+  for(size_t i=0; i<N*count; i++) {
     x[i] = real_rand<double>();
   }
 
+  std::vector<double> y(N * count);
+  std::vector<int> dur;
+
   // Compute Fast Walsh Hadamard
-  fast_walsh_hadamard<double>(x);
+  for(size_t rep=0; rep<total_rep; rep++) {
+    y = x;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    fast_walsh_hadamard_batch<double>(y.data(), N, count, N);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    dur.push_back(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+  }
+
+  if(bench) {
+    // Take medians
+    std::sort(dur.begin(), dur.end());
+    std::cout << "Duration: " << dur[total_rep/2] << " us." << std::endl;
+  }
 
   return 0;
 }
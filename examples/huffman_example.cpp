@@ -1,139 +1,99 @@
-#include <cstdlib> 
-#include <iostream> 
-#include <vector>
+#include <getopt.h>
+#include <chrono>
+#include <fstream>
 
-// Thanks to https://www.geeksforgeeks.org/huffman-coding-greedy-algo-3/
+#include "huffman.hpp"
+#include "blockpack.hpp"
+#include "mmap.hpp"
 
-struct HuffmanNode { 
-  HuffmanNode (char d, float f)
-    : data { d }, freq { f }, left { NULL }, right { NULL } { 
-  }
-
-  HuffmanNode (float f)
-    : data { '*' }, freq { f }, left { NULL }, right { NULL } { 
-  }
-
-  char data; 
-  float freq; 
-  struct HuffmanNode* left; 
-  struct HuffmanNode* right; 
-};
-
-void swapNode(struct HuffmanNode** a, struct HuffmanNode** b) {
-  struct HuffmanNode* tmp = *a;
-  *a = *b;
-  *b = tmp;
-} 
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-struct Huffman { 
-  struct HuffmanNode* extractMin() {
-    struct HuffmanNode* min_ptr = array[0]; 
-    array[0] = array[size - 1]; 
-    size--; 
-    minHeapify(0); 
-    return min_ptr;
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename;
+  size_t block_kb = BLOCKPACK_BLOCK_SIZE / 1024;
+  size_t threads = 0;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:b:t:h")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 'b':
+        block_kb = atoi(optarg);
+        continue;
+      case 't':
+        threads = atoi(optarg);
+        continue;
+      case 'h':
+      default :
+        printf("Usage: huffman_example [-f file] [-b block-KB] [-t threads]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
   }
 
-  void insert(struct HuffmanNode* minHeapNode) { 
-    size_t i = size; 
-    while (i && minHeapNode->freq < array[(i - 1) / 2]->freq) { 
-      array[i] = array[(i - 1) / 2]; 
-      i = (i - 1) / 2;
+  // Codes of a few symbols
+  if(filename.empty()) {
+    std::vector<char> symbols = { 'a', 'b', 'c', 'd', 'e', 'f' };
+    std::vector<uint64_t> freq = { 5, 9, 12, 13, 16, 45 };
+
+    std::vector<uint8_t> lengths = huffman_code_lengths(freq.data(), freq.size());
+    std::vector<uint32_t> codes = canonical_codes(lengths);
+    for(size_t s=0; s<symbols.size(); s++) {
+      // Codes are stored bit-reversed
+      std::cout << symbols[s] << ": ";
+      for(size_t b=0; b<lengths[s]; b++)
+        std::cout << ((codes[s] >> b) & 1);
+      std::cout << std::endl;
     }
-    array[i] = minHeapNode; 
-    size++;
-  } 
-
-  void minHeapify(size_t idx) {
-    // Min-Heap: The value of the root node must be the smallest among all its descendant nodes and the same thing must be done for its left and right sub-tree
-    int smallest = idx; 
-    int left = 2 * idx + 1; 
-    int right = 2 * idx + 2; 
-
-    if (left < size && array[left]->freq < array[smallest]->freq) 
-      smallest = left; 
-
-    if (right < size && array[right]->freq < array[smallest]->freq) 
-      smallest = right; 
-
-    if (smallest != idx) {
-      swapNode(&array[smallest], &array[idx]); 
-      minHeapify(smallest); 
-    } 
+    return 0;
   }
 
-  size_t size; 
-  size_t capacity; 
-  struct HuffmanNode** array; 
-}; 
-
-struct HuffmanNode* buildHuffmanTree(std::vector<char> data, std::vector<float> freq) {
-  size_t size = freq.size();
-
-  // Create a min heap of capacity equal to size and nodes equal to size. 
-  struct Huffman* minHeap = (struct Huffman*)malloc(sizeof(struct Huffman));
-  minHeap->capacity = size;
-  minHeap->size = size;
-  minHeap->array = (struct HuffmanNode **)malloc(minHeap->capacity * sizeof(struct HuffmanNode *)); 
-  for (size_t i = 0; i < size; ++i) 
-    minHeap->array[i] = new HuffmanNode(data[i], freq[i]);
-
-  for (int i = (minHeap->size - 2) / 2; i >= 0; --i) 
-    minHeap->minHeapify(i); 
-
-  // Iterate while size of heap doesn't become 1
-  struct HuffmanNode *left;
-  struct HuffmanNode *right;
-  struct HuffmanNode *top;
-  while (minHeap->size != 1) { 
-    // Extract the two minimum freq items
-    left  = minHeap->extractMin(); 
-    right = minHeap->extractMin(); 
+  // Compress and decompress a file, as a single stream then in blocks
+  MappedFile file(filename);
+  size_t size = file.size();
 
-    // Create a new internal node with frequency equal to the sum of the two frequencies 
-    top = new HuffmanNode(left->freq + right->freq);
-    top->left  = left; 
-    top->right = right; 
-    minHeap->insert(top); 
-  } 
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> packed = huffman_compress(file.data(), size);
+  double t_enc = seconds_since(start);
 
-  // The remaining node is the root node and the tree is complete
-  return minHeap->extractMin();
-} 
+  start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> unpacked = huffman_decompress(packed.data(), packed.size());
+  double t_dec = seconds_since(start);
 
-void printCodes(struct HuffmanNode* root, int* arr, int i) {
-  // Go down left edge
-  if (root->left) { 
-    arr[i] = 0; 
-    printCodes(root->left, arr, i + 1); 
+  if(unpacked.size() != size || !std::equal(unpacked.begin(), unpacked.end(), file.data())) {
+    std::cout << "The decompressed data differs from " << filename << std::endl;
+    exit(1);
   }
+  std::cout << "Single stream: " << size << " -> " << packed.size() << " bytes (" << 100.0 * packed.size() / std::max<size_t>(size, 1) << "%)" << std::endl;
+  std::cout << "  encode: " << size / t_enc / 1e6 << " MB/s, decode: " << size / t_dec / 1e6 << " MB/s" << std::endl;
 
-  // Go down right edge
-  if (root->right) { 
-    arr[i] = 1;
-    printCodes(root->right, arr, i + 1); 
-  } 
+  start = std::chrono::steady_clock::now();
+  packed = blockpack_compress(file.data(), size, block_kb * 1024, threads);
+  t_enc = seconds_since(start);
 
-  // Leaf node, print the code
-  if (!(root->left) && !(root->right)) {
-    std::cout << root->data << ": "; 
-    for (size_t k=0; k<i; ++k) 
-      std::cout << arr[k]; 
-    std::cout << std::endl;
-  }
-} 
-
-int main() {
-  std::vector<char> arr = { 'a', 'b', 'c', 'd', 'e', 'f' }; 
-  std::vector<float> freq = { 0.05, 0.09, 0.12, 0.13, 0.16, 0.45 }; 
+  start = std::chrono::steady_clock::now();
+  BlockPackReader reader(packed.data(), packed.size());
+  unpacked = reader.read_all(threads);
+  t_dec = seconds_since(start);
 
-  // Construct Huffman tree 
-  struct HuffmanNode* root = buildHuffmanTree(arr, freq); 
+  if(unpacked.size() != size || !std::equal(unpacked.begin(), unpacked.end(), file.data())) {
+    std::cout << "The decompressed blocks differ from " << filename << std::endl;
+    exit(1);
+  }
+  std::cout << reader.num_blocks() << " blocks of " << block_kb << " KB on " << num_threads(threads) << " threads: "
+            << size << " -> " << packed.size() << " bytes (" << 100.0 * packed.size() / std::max<size_t>(size, 1) << "%)" << std::endl;
+  std::cout << "  encode: " << size / t_enc / 1e6 << " MB/s, decode: " << size / t_dec / 1e6 << " MB/s" << std::endl;
 
-  // Print Huffman codes
-  int arr2[100];
-  printCodes(root, arr2, 0); 
+  std::ofstream fs(filename + ".huf", std::ios::binary);
+  fs.write((const char*)packed.data(), packed.size());
 
-  return 0; 
+  return 0;
 }
-
@@ -1,20 +1,33 @@
 #include <getopt.h>
 
 #include "netpbm.hpp"
+#include "strip.hpp"
 
 int main(int argc, char** argv) {
   // Default value
   std::string filename = "examples/edwige_256.ppm";
+  bool dither = false;
+  bool stream = false;
+  bool plain = false;
 
   // Read options
   for(;;) {
-    switch(getopt(argc, argv, "n:r:f:sbhw")) {
+    switch(getopt(argc, argv, "n:r:f:dsabhw")) {
       case 'f':
         filename = optarg;
         continue;
+      case 'd':
+        dither = true;
+        continue;
+      case 's':
+        stream = true;
+        continue;
+      case 'a':
+        plain = true;
+        continue;
       case 'h':
       default :
-        printf("Usage: netpbm_example [-f file.ppm]\n");
+        printf("Usage: netpbm_example [-f file.ppm] [-d (dithered pbm)] [-s (strip pipeline)] [-a (plain ASCII output)]\n");
         return 0;
         break;
       case -1:
@@ -23,6 +36,21 @@ int main(int argc, char** argv) {
     break;
   }
 
+  // Stream the image in strips of rows: grayscale, and grayscale, blur and threshold
+  if(stream) {
+    std::string filename_clean = filename.substr(0, filename.size() - 4);
+
+    StripPipeline gray;
+    gray.add<GrayscaleStage>();
+    gray.run(filename, filename_clean + "_strip.pgm");
+
+    StripPipeline baw;
+    baw.add<GrayscaleStage>().add<BoxFilterStage>().add<ThresholdStage>();
+    baw.run(filename, filename_clean + "_strip.pbm");
+
+    return 0;
+  }
+
   netpbm n;
 
   // Open .ppm RGB image
@@ -30,26 +58,26 @@ int main(int argc, char** argv) {
   std::string filename_clean = filename.substr(0, filename.size() - 4);
   std::string filename_ppm = filename_clean + "_from_ppm";
   // Save .ppm RGB image (again)
-  n.encoder(filename_ppm, "ppm");
+  n.encoder(filename_ppm, "ppm", false, plain);
   // Save .pgm grayscale image
-  n.encoder(filename_ppm, "pgm");
+  n.encoder(filename_ppm, "pgm", false, plain);
   // Save .pgm grayscale image
-  n.encoder(filename_ppm, "pbm");
+  n.encoder(filename_ppm, "pbm", dither, plain);
 
   // Open .pgm grayscale image
   n.decoder(filename_ppm + ".pgm");
   std::string filename_ppm_clean = filename_ppm.substr(0, filename.size() - 4);
   std::string filename_pgm = filename_ppm_clean + "_from_pgm";
   // Save .pgm grayscale image (again)
-  n.encoder(filename_pgm, "pgm");
+  n.encoder(filename_pgm, "pgm", false, plain);
   // Save .pgm grayscale image
-  n.encoder(filename_pgm, "pbm");
+  n.encoder(filename_pgm, "pbm", dither, plain);
 
   // Open .pbm black and white image
   n.decoder(filename_ppm + ".pbm");
   std::string filename_pbm = filename_ppm_clean + "_from_pbm";
   // Save .pbm grayscale image (again)
-  n.encoder(filename_pbm, "pbm");
+  n.encoder(filename_pbm, "pbm", dither, plain);
 
   return 0;
 }
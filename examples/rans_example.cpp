@@ -0,0 +1,104 @@
+#include <getopt.h>
+#include <chrono>
+#include <cmath>
+
+#include "rans.hpp"
+#include "huffman.hpp"
+#include "dwt.hpp"
+#include "netpbm.hpp"
+#include "mmap.hpp"
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Bytes of an order-0 coder reaching the entropy of the byte histogram
+double entropy_bytes(const std::vector<uint8_t>& data) {
+  std::vector<uint64_t> freq = byte_histogram(data.data(), data.size());
+  double bits = 0;
+  for(uint64_t f : freq)
+    if(f > 0)
+      bits -= f * std::log2((double)f / data.size());
+  return bits / 8;
+}
+
+// Compress and decompress with both coders, print the size and speed
+template <typename C, typename D>
+void bench(const std::string& name, const std::vector<uint8_t>& data, C compress, D decompress) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> packed = compress(data.data(), data.size());
+  double t_enc = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> unpacked = decompress(packed.data(), packed.size());
+  double t_dec = seconds_since(start);
+
+  if(unpacked != data) {
+    std::cout << "The " << name << " decompressed data differs from the input." << std::endl;
+    exit(1);
+  }
+  std::cout << name << ": " << packed.size() << " bytes (" << 100.0 * packed.size() / std::max<size_t>(data.size(), 1) << "%), "
+            << "encode: " << data.size() / t_enc / 1e6 << " MB/s, decode: " << data.size() / t_dec / 1e6 << " MB/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename = "examples/edwige_512.ppm";
+  double step = 8;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:q:h")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 'q':
+        step = atof(optarg);
+        continue;
+      case 'h':
+      default :
+        printf("Usage: rans_example [-f file] [-q step]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
+  }
+
+  // Images: wavelet coefficients quantized with the given step, as signed
+  // bytes. Other files: their bytes.
+  std::vector<uint8_t> data;
+  std::string ext = filename.substr(filename.size() - 3);
+  if(ext == "ppm" || ext == "pgm") {
+    netpbm img;
+    img.decoder(filename);
+    if(img.is_baw()) {
+      std::cout << "Only grayscale and RGB images are supported." << std::endl;
+      exit(1);
+    }
+    size_t width = img.get_width();
+    size_t height = img.get_height();
+    size_t n = width * height;
+    size_t channels = img.is_rgb() ? 3 : 1;
+    std::vector<float> plane(n);
+    for(size_t ch=0; ch<channels; ch++) {
+      raster_to_plane(img.data(), n, channels, ch, img.get_depth(), plane.data());
+      dwt_2D(plane.data(), height, width, width, Wavelet::cdf97, 4);
+      for(size_t i=0; i<n; i++)
+        data.push_back((int8_t)std::clamp<float>(std::round(plane[i] / step), -128, 127));
+    }
+    std::cout << width << " x " << height << " x " << channels << " wavelet coefficients, step " << step << std::endl;
+  }
+  else {
+    MappedFile file(filename);
+    data.assign(file.data(), file.data() + file.size());
+    std::cout << filename << ": " << data.size() << " bytes" << std::endl;
+  }
+
+  std::cout << "Entropy: " << entropy_bytes(data) << " bytes (" << 100.0 * entropy_bytes(data) / std::max<size_t>(data.size(), 1) << "%)" << std::endl;
+  bench("Huffman", data, huffman_compress, huffman_decompress);
+  bench("rANS", data, rans_compress, rans_decompress);
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <getopt.h>
+#include <chrono>
+
+#include "resample.hpp"
+
+int main(int argc, char** argv) {
+  // Default values
+  std::string filename = "examples/edwige_1024.ppm";
+  size_t width = 256;
+  size_t height = 0;
+  size_t levels = 0;
+  ResampleFilter filter = ResampleFilter::lanczos3;
+
+  // Read options
+  for(;;) {
+    switch(getopt(argc, argv, "f:W:H:k:p:h")) {
+      case 'f':
+        filename = optarg;
+        continue;
+      case 'W':
+        width = atoi(optarg);
+        continue;
+      case 'H':
+        height = atoi(optarg);
+        continue;
+      case 'k':
+        if(std::string(optarg) == "box")
+          filter = ResampleFilter::box;
+        else if(std::string(optarg) == "bicubic")
+          filter = ResampleFilter::bicubic;
+        continue;
+      case 'p':
+        levels = atoi(optarg);
+        continue;
+      case 'h':
+      default :
+        printf("Usage: resample_example [-f file.ppm|file.pgm] [-W width] [-H height] [-k lanczos3|bicubic|box] [-p pyramid-levels]\n");
+        return 0;
+        break;
+      case -1:
+        break;
+    }
+    break;
+  }
+
+  netpbm img;
+  img.decoder(filename);
+  std::string filename_clean = filename.substr(0, filename.size() - 4);
+  std::string ext = img.is_rgb() ? "ppm" : "pgm";
+  double mpixels = (double)img.get_width() * img.get_height() / 1e6;
+
+  // Pyramid of halved images
+  if(levels > 0) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<netpbm> pyramid = build_pyramid(img, levels, filter);
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << pyramid.size() << " levels: " << seconds * 1e3 << " ms (" << mpixels / seconds << " MP/s)" << std::endl;
+
+    for(size_t l=0; l<pyramid.size(); l++)
+      pyramid[l].encoder(filename_clean + "_level" + std::to_string(l + 1), ext);
+    return 0;
+  }
+
+  // The height keeps the aspect ratio by default
+  if(height == 0)
+    height = std::max<size_t>(1, std::lround((double)width * img.get_height() / img.get_width()));
+
+  auto start = std::chrono::steady_clock::now();
+  netpbm out = resize(img, width, height, filter);
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+  std::cout << img.get_width() << " x " << img.get_height() << " to " << width << " x " << height << ": "
+            << seconds * 1e3 << " ms (" << mpixels / seconds << " MP/s)" << std::endl;
+
+  out.encoder(filename_clean + "_" + std::to_string(width) + "x" + std::to_string(height), ext);
+
+  return 0;
+}
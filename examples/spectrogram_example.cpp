@@ -1,25 +1,38 @@
+#include <iomanip>
+#include <bit>
+
 #include "fft.hpp"
 #include "wav.hpp"
 #include "window.hpp"
+#include "npy.hpp"
+#include "netpbm.hpp"
 
 int main(int argc, char** argv) {
   // Default values
   size_t N = 64;
   size_t r = 2;
   char* filename = nullptr;
+  std::string format = "txt";
+  double range_db = 80;
 
   // Read options
   for(;;) {
-    switch(getopt(argc, argv, "n:f:h")) {
+    switch(getopt(argc, argv, "n:f:o:d:h")) {
       case 'n':
         N = atoi(optarg);
         continue;
       case 'f':
         filename = optarg;
         continue;
+      case 'o':
+        format = optarg;
+        continue;
+      case 'd':
+        range_db = atof(optarg);
+        continue;
       case 'h':
       default :
-        printf("Usage: spectrogram_example -f file.wav [-n FFT-size]\n");
+        printf("Usage: spectrogram_example -f file.wav [-n FFT-size] [-o txt|raw|npy|pgm] [-d dB-range]\n");
         return 0;
         break;
       case -1:
@@ -38,40 +51,110 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  // Input signal
-  std::vector<Cpx<double>> x;
-
-  std::ifstream fs(filename, std::ios::binary);
-  if(fs.is_open()) {
-    WavHeader header;
-    signal_from_wav_file<Cpx<double>>(fs, header, x, true);
-    fs.close();
+  if(format != "txt" && format != "raw" && format != "npy" && format != "pgm") {
+    std::cout << "Unknown output format " << format << std::endl;
+    exit(1);
   }
-  else {
-    std::cout << "Cannot open " << filename << std::endl;
+
+  // Input signal, read ahead on another thread in blocks of whole FFT frames
+  AsyncWavReader<Cpx<double>> wav(filename, 256 * N);
+  if(wav.get_header().num_channels != 1) {
+    std::cout << "Only mono files are supported." << std::endl;
     exit(1);
   }
 
   std::cout << "Running " << N << "-point radix-" << r << " FFT";
 
+  // Outputs: one row of N magnitudes per frame, except for the image that
+  // keeps the N/2 positive frequencies of each frame until the end
   std::ofstream output_file;
-  output_file.open ("tools/spectrogram.txt");
+  std::unique_ptr<NpyWriter<float>> npy;
+  if(format == "txt") {
+    output_file.open("tools/spectrogram.txt");
+  }
+  else if(format == "raw") {
+    // "SPEC", number of frames, N, then little-endian float32 values
+    output_file.open("tools/spectrogram.f32", std::ios::binary);
+    output_file.write("SPEC\0\0\0\0\0\0\0\0", 12);
+  }
+  else if(format == "npy") {
+    npy = std::make_unique<NpyWriter<float>>("tools/spectrogram.npy", N);
+  }
+
+  std::vector<float> row(N);
+  std::vector<float> image;
+  size_t frames = 0;
 
   // Run FFT on different frames
-  for(size_t i=0; i<x.size() / N ; i++) {
-    std::vector<Cpx<double>>::const_iterator first = x.begin() + i*N;
-    std::vector<Cpx<double>>::const_iterator last  = x.begin() + (i+1)*N;
-    std::vector<Cpx<double>> y(first, last);
+  std::vector<Cpx<double>> y(N);
+  for(std::span<const Cpx<double>> block = wav.next(); !block.empty(); block = wav.next()) {
+    for(size_t i=0; i + N <= block.size(); i += N) {
+      std::copy(block.begin() + i, block.begin() + i + N, y.begin());
 
-    fft<double>(y.data(), N, r, false);
-    reverse_reorder(y, N, r); // re-order output
+      fft<double>(y.data(), N, r, false);
+      reverse_reorder(y, N, r); // re-order output
 
-    for(const auto& y_i : y)
-      output_file << std::setprecision(5) << y_i.abs() << " ";
-    output_file << std::endl;
+      if(format == "txt") {
+        for(const auto& y_i : y)
+          output_file << std::setprecision(5) << y_i.abs() << " ";
+        output_file << std::endl;
+      }
+      else if(format == "pgm") {
+        for(size_t k=0; k<N/2; k++)
+          image.push_back(y[k].abs());
+      }
+      else {
+        for(size_t k=0; k<N; k++)
+          row[k] = y[k].abs();
+        if(format == "raw") {
+          // Little-endian like the sizes in the header
+          if constexpr(std::endian::native != std::endian::little) {
+            for(size_t k=0; k<N; k++)
+              big_to_little_endian_4(std::bit_cast<uint32_t>(row[k]), (char*)&row[k]);
+          }
+          output_file.write((const char*)row.data(), N * sizeof(float));
+        }
+        else
+          npy->write_row(row.data());
+      }
+      frames++;
+    }
   }
 
+  if(format == "raw") {
+    char size[8];
+    big_to_little_endian_4(frames, size);
+    big_to_little_endian_4(N, size + 4);
+    output_file.seekp(4);
+    output_file.write(size, 8);
+  }
   output_file.close();
+  npy.reset();
+
+  if(format == "pgm") {
+    if(frames == 0) {
+      std::cout << ": no frame to draw." << std::endl;
+      return 0;
+    }
+    // Time on x, frequency on y with the highest at the top, in dB from
+    // the maximum down to -range_db, mapped to 0..255 (all black when the
+    // input is silent)
+    size_t height = N/2;
+    float peak = *std::max_element(image.begin(), image.end());
+    std::vector<uint8_t> pixels(frames * height);
+    for(size_t t=0; t<frames; t++) {
+      for(size_t k=0; k<height; k++) {
+        double v = 0;
+        if(peak > 0) {
+          double db = 20 * log10(std::max(image[t*height + k] / peak, 1e-12f));
+          v = std::clamp(1 + db / range_db, 0.0, 1.0);
+        }
+        pixels[(height - 1 - k) * frames + t] = (uint8_t)round(255 * v);
+      }
+    }
+    netpbm img("P5", frames, height, 255, pixels.data());
+    img.encoder("tools/spectrogram", "pgm");
+  }
 
   return 0;
 }
@@ -0,0 +1,213 @@
+#ifndef BLOCKPACK_H
+#define BLOCKPACK_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "huffman.hpp"
+#include "histogram.hpp"
+#include "parallel.hpp"
+
+// Container of independently compressed blocks. The input is cut into
+// blocks of block_size bytes (the last one may be shorter), each with its
+// own Huffman code, so the blocks are compressed and decompressed on all
+// the threads, and a byte range is read back by decoding only the blocks
+// that it covers.
+//
+// Layout, little-endian:
+//   "BPK1", the block size (4 bytes), the input size (8 bytes)
+//   the index: for each block, its offset in the container (8 bytes), its
+//   packed size (4 bytes) and its kind (4 bytes)
+//   the blocks
+// A Huffman block holds the 256 code lengths on 4 bits each, then the
+// codes. A block that would not get smaller is stored as is.
+
+constexpr size_t BLOCKPACK_HEADER = 16;
+constexpr size_t BLOCKPACK_ENTRY = 16;
+constexpr size_t BLOCKPACK_BLOCK_SIZE = (size_t)1 << 18;
+
+enum class BlockKind { stored, huffman };
+
+inline std::vector<uint8_t> blockpack_compress(const uint8_t* data, size_t size, size_t block_size = BLOCKPACK_BLOCK_SIZE, size_t threads = 0) {
+  if(block_size == 0 || block_size > UINT32_MAX) {
+    std::cout << "The block size must be between 1 and " << UINT32_MAX << " bytes." << std::endl;
+    exit(1);
+  }
+  size_t count = (size + block_size - 1) / block_size;
+  std::vector<std::vector<uint8_t>> packed(count);
+  std::vector<BlockKind> kinds(count);
+
+  // Tables of each worker, rebuilt for each block
+  struct Scratch {
+    HuffmanBuilder builder;
+    std::vector<uint64_t> freq = std::vector<uint64_t>(256);
+    std::vector<uint8_t> lengths = std::vector<uint8_t>(256);
+  };
+  std::vector<Scratch> scratch(num_threads(threads));
+
+  parallel_tasks(count, [&](size_t b, size_t worker) {
+    Scratch& s = scratch[worker];
+    const uint8_t* block = data + b * block_size;
+    size_t n = std::min(block_size, size - b * block_size);
+    byte_histogram(block, n, s.freq.data());
+    s.builder.build(s.freq.data(), 256, HUFFMAN_MAX_BITS, s.lengths.data());
+    std::vector<uint32_t> codes = canonical_codes(s.lengths);
+
+    BitWriter writer(n + 128);
+    huffman_write_lengths(writer, s.lengths.data());
+    huffman_encode(block, n, s.lengths.data(), codes.data(), writer);
+    packed[b] = writer.finish();
+    kinds[b] = BlockKind::huffman;
+    if(packed[b].size() >= n) {
+      packed[b].assign(block, block + n);
+      kinds[b] = BlockKind::stored;
+    }
+  }, threads);
+
+  size_t total = BLOCKPACK_HEADER + count * BLOCKPACK_ENTRY;
+  for(auto& p : packed)
+    total += p.size();
+  std::vector<uint8_t> out(total);
+  memcpy(out.data(), "BPK1", 4);
+  store_le32(out.data() + 4, block_size);
+  store_le64(out.data() + 8, size);
+  size_t offset = BLOCKPACK_HEADER + count * BLOCKPACK_ENTRY;
+  for(size_t b=0; b<count; b++) {
+    uint8_t* entry = out.data() + BLOCKPACK_HEADER + b * BLOCKPACK_ENTRY;
+    store_le64(entry, offset);
+    store_le32(entry + 8, packed[b].size());
+    store_le32(entry + 12, (uint32_t)kinds[b]);
+    std::copy(packed[b].begin(), packed[b].end(), out.begin() + offset);
+    offset += packed[b].size();
+  }
+  return out;
+}
+
+// Reads the blocks of a container in memory (the data must outlive the
+// reader). The header and index are checked on construction.
+struct BlockPackReader {
+  // Constructor
+  BlockPackReader(const uint8_t* data, size_t size)
+  : data { data } {
+    if(size < BLOCKPACK_HEADER || memcmp(data, "BPK1", 4) != 0) {
+      std::cout << "The data is not a block container." << std::endl;
+      exit(1);
+    }
+    block_size = load_le32(data + 4);
+    raw_size = load_le64(data + 8);
+    if(block_size == 0) {
+      std::cout << "The block size of the container is 0." << std::endl;
+      exit(1);
+    }
+    count = raw_size / block_size + (raw_size % block_size != 0);
+    if(count > (size - BLOCKPACK_HEADER) / BLOCKPACK_ENTRY) {
+      std::cout << "The block index is truncated." << std::endl;
+      exit(1);
+    }
+
+    size_t start = BLOCKPACK_HEADER + count * BLOCKPACK_ENTRY;
+    offsets.resize(count);
+    sizes.resize(count);
+    kinds.resize(count);
+    for(size_t b=0; b<count; b++) {
+      const uint8_t* entry = data + BLOCKPACK_HEADER + b * BLOCKPACK_ENTRY;
+      offsets[b] = load_le64(entry);
+      sizes[b] = load_le32(entry + 8);
+      uint32_t kind = load_le32(entry + 12);
+      bool valid = offsets[b] >= start && offsets[b] <= size && sizes[b] <= size - offsets[b];
+      if(kind == (uint32_t)BlockKind::stored)
+        valid = valid && sizes[b] == block_length(b);
+      else if(kind != (uint32_t)BlockKind::huffman)
+        valid = false;
+      if(!valid) {
+        std::cout << "Block " << b << " of the container is invalid." << std::endl;
+        exit(1);
+      }
+      kinds[b] = (BlockKind)kind;
+    }
+  }
+
+  // Methods
+  // Decompressed size
+  size_t size() const {
+    return raw_size;
+  }
+
+  size_t num_blocks() const {
+    return count;
+  }
+
+  size_t get_block_size() const {
+    return block_size;
+  }
+
+  // Bytes of block b once decompressed
+  size_t block_length(size_t b) const {
+    return std::min<size_t>(block_size, raw_size - b * block_size);
+  }
+
+  // The block_length(b) bytes of block b
+  void decode_block(size_t b, uint8_t* out) const {
+    const uint8_t* p = data + offsets[b];
+    size_t n = block_length(b);
+    if(kinds[b] == BlockKind::stored) {
+      memcpy(out, p, n);
+      return;
+    }
+    BitReader reader(p, sizes[b]);
+    std::vector<uint8_t> lengths(256);
+    huffman_read_lengths(reader, lengths.data());
+    HuffmanDecoder decoder(lengths);
+    huffman_decode(reader, decoder, out, n);
+  }
+
+  // length bytes from position first, decoding the blocks in parallel.
+  // Blocks that are only partly in the range go through a scratch block.
+  void read(size_t first, size_t length, uint8_t* out, size_t threads = 0) const {
+    if(first > raw_size || length > raw_size - first) {
+      std::cout << "Bytes " << first << " to " << first + length << " are out of the " << raw_size << " bytes of the container." << std::endl;
+      exit(1);
+    }
+    if(length == 0)
+      return;
+    size_t b0 = first / block_size;
+    size_t b1 = (first + length - 1) / block_size + 1;
+    std::vector<std::vector<uint8_t>> scratch(num_threads(threads));
+    parallel_tasks(b1 - b0, [&](size_t i, size_t worker) {
+      size_t b = b0 + i;
+      size_t start = b * block_size;
+      size_t n = block_length(b);
+      if(start >= first && start + n <= first + length) {
+        decode_block(b, out + (start - first));
+        return;
+      }
+      scratch[worker].resize(block_size);
+      decode_block(b, scratch[worker].data());
+      size_t lo = std::max(start, first);
+      size_t hi = std::min(start + n, first + length);
+      memcpy(out + (lo - first), scratch[worker].data() + (lo - start), hi - lo);
+    }, threads);
+  }
+
+  std::vector<uint8_t> read_all(size_t threads = 0) const {
+    std::vector<uint8_t> out(raw_size);
+    read(0, raw_size, out.data(), threads);
+    return out;
+  }
+
+  // Attributes
+  private:
+    const uint8_t* data;
+    size_t block_size;
+    size_t raw_size;
+    size_t count;
+    std::vector<size_t> offsets;
+    std::vector<size_t> sizes;
+    std::vector<BlockKind> kinds;
+};
+
+#endif
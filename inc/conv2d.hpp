@@ -0,0 +1,251 @@
+#ifndef CONV2D_H
+#define CONV2D_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "complex.hpp"
+#include "fft.hpp"
+#include "parallel.hpp"
+#include "netpbm.hpp"
+
+// 2D convolution of images (planes of width * height samples, row by row)
+// with a kernel of rows x cols taps. The output has the size of the input:
+// the center tap (row (rows-1)/2, column (cols-1)/2) lies on the output
+// pixel and the border pixels are repeated outside the image.
+//
+// Small kernels are applied directly. Larger ones go through overlap-save:
+// the padded image is cut in N x N tiles overlapping by the kernel size
+// minus one, each tile is multiplied by the kernel spectrum (computed once)
+// and the aliased rows and columns of the inverse FFT are dropped. The
+// image is real, so two tiles travel in one complex FFT, one in the real
+// part and one in the imaginary part.
+
+// Up to this number of taps the convolution is direct
+constexpr size_t CONV2D_DIRECT_MAX_TAPS = 15 * 15;
+
+// Smallest FFT tile
+constexpr size_t CONV2D_MIN_TILE = 64;
+
+enum class Conv2DMethod { automatic, direct, fft };
+
+template <typename T>
+struct Convolver2D {
+  // Constructor
+  // With correlate, the kernel slides over the image without being flipped
+  Convolver2D(const std::vector<T>& kernel, size_t rows, size_t cols, bool correlate = false, Conv2DMethod method = Conv2DMethod::automatic)
+  : rows { rows }, cols { cols } {
+    if(kernel.size() != rows * cols || rows == 0 || cols == 0) {
+      std::cout << "The kernel must have rows x cols taps." << std::endl;
+      exit(1);
+    }
+    if(method == Conv2DMethod::automatic)
+      method = (rows * cols <= CONV2D_DIRECT_MAX_TAPS) ? Conv2DMethod::direct : Conv2DMethod::fft;
+    use_fft = (method == Conv2DMethod::fft);
+
+    // Kernel as applied by the convolution (taps in convolution order)
+    taps = kernel;
+    if(correlate)
+      std::reverse(taps.begin(), taps.end());
+
+    if(use_fft)
+      make_spectrum();
+  }
+
+  // Methods
+  bool uses_fft() const {
+    return use_fft;
+  }
+
+  size_t get_tile() const {
+    return tile;
+  }
+
+  void apply(const T* in, T* out, size_t width, size_t height, size_t threads = 0) const {
+    // Image with rows - 1 and cols - 1 repeated border pixels
+    size_t top = rows - 1 - (rows - 1) / 2;
+    size_t left = cols - 1 - (cols - 1) / 2;
+    size_t pw = width + cols - 1;
+    size_t ph = height + rows - 1;
+    std::vector<T> padded(pw * ph);
+    for(size_t y=0; y<ph; y++) {
+      const T* src = in + std::clamp<long>((long)y - top, 0, height - 1) * width;
+      T* dst = padded.data() + y*pw;
+      for(size_t x=0; x<pw; x++)
+        dst[x] = src[std::clamp<long>((long)x - left, 0, width - 1)];
+    }
+
+    if(use_fft)
+      apply_fft(padded.data(), pw, ph, out, width, height, threads);
+    else
+      apply_direct(padded.data(), pw, out, width, height, threads);
+  }
+
+  // Attributes
+  private:
+    // out(r, c) = sum of taps(i, j) * padded(r + rows - 1 - i, c + cols - 1 - j),
+    // accumulated tap by tap over whole output rows
+    void apply_direct(const T* padded, size_t pw, T* out, size_t width, size_t height, size_t threads) const {
+      parallel_for(height, [&](size_t begin, size_t end) {
+        for(size_t r=begin; r<end; r++) {
+          T* o = out + r*width;
+          std::fill(o, o + width, 0);
+          for(size_t i=0; i<rows; i++) {
+            for(size_t j=0; j<cols; j++) {
+              T k = taps[(rows - 1 - i) * cols + (cols - 1 - j)];
+              const T* p = padded + (r + i) * pw + j;
+              for(size_t c=0; c<width; c++)
+                o[c] += k * p[c];
+            }
+          }
+        }
+      }, pixel_threads(width, height, threads));
+    }
+
+    // Tiles of N x N padded samples give (N - rows + 1) x (N - cols + 1) outputs
+    void apply_fft(const T* padded, size_t pw, size_t ph, T* out, size_t width, size_t height, size_t threads) const {
+      size_t N = tile;
+      size_t step_r = N - rows + 1;
+      size_t step_c = N - cols + 1;
+      size_t tiles_r = (height + step_r - 1) / step_r;
+      size_t tiles_c = (width + step_c - 1) / step_c;
+      size_t tiles = tiles_r * tiles_c;
+      size_t pairs = (tiles + 1) / 2;
+
+      parallel_for(pairs, [&](size_t begin, size_t end) {
+        std::vector<Cpx<T>> buf(N * N);
+        for(size_t p=begin; p<end; p++) {
+          // Tile 2p in the real part, tile 2p+1 (if any) in the imaginary part
+          std::fill(buf.begin(), buf.end(), Cpx<T>(0, 0));
+          for(size_t k=0; k<2 && 2*p + k < tiles; k++) {
+            size_t y0 = (2*p + k) / tiles_c * step_r;
+            size_t x0 = (2*p + k) % tiles_c * step_c;
+            size_t h = std::min(N, ph - y0);
+            size_t w = std::min(N, pw - x0);
+            for(size_t u=0; u<h; u++) {
+              const T* src = padded + (y0 + u) * pw + x0;
+              Cpx<T>* dst = buf.data() + u*N;
+              if(k == 0)
+                for(size_t v=0; v<w; v++)
+                  dst[v] = Cpx<T>(src[v], 0);
+              else
+                for(size_t v=0; v<w; v++)
+                  dst[v] = Cpx<T>(dst[v].real(), src[v]);
+            }
+          }
+
+          fft_2D(buf.data(), N, N, N, 2, false, 1);
+          for(size_t n=0; n<N*N; n++)
+            buf[n] *= spectrum[n];
+          fft_2D(buf.data(), N, N, N, 2, true, 1);
+
+          // Rows and columns below rows - 1 and cols - 1 are aliased
+          for(size_t k=0; k<2 && 2*p + k < tiles; k++) {
+            size_t r0 = (2*p + k) / tiles_c * step_r;
+            size_t c0 = (2*p + k) % tiles_c * step_c;
+            size_t h = std::min(step_r, height - r0);
+            size_t w = std::min(step_c, width - c0);
+            for(size_t u=0; u<h; u++) {
+              const Cpx<T>* src = buf.data() + (u + rows - 1) * N + cols - 1;
+              T* dst = out + (r0 + u) * width + c0;
+              if(k == 0)
+                for(size_t v=0; v<w; v++)
+                  dst[v] = src[v].real();
+              else
+                for(size_t v=0; v<w; v++)
+                  dst[v] = src[v].imag();
+            }
+          }
+        }
+      }, num_threads(threads));
+    }
+
+    // Power of two at least four times the kernel, so that most of each
+    // tile is output
+    void make_spectrum() {
+      tile = CONV2D_MIN_TILE;
+      while(tile < 4 * std::max(rows, cols))
+        tile *= 2;
+      spectrum.assign(tile * tile, Cpx<T>(0, 0));
+      for(size_t i=0; i<rows; i++)
+        for(size_t j=0; j<cols; j++)
+          spectrum[i*tile + j] = Cpx<T>(taps[i*cols + j], 0);
+      fft_2D(spectrum.data(), tile, tile, tile, 2, false);
+    }
+
+    size_t rows, cols;
+    bool use_fft;
+    std::vector<T> taps;
+    size_t tile = 0;
+    std::vector<Cpx<T>> spectrum;
+};
+
+// Normalized kernels
+template <typename T>
+std::vector<T> box_kernel(size_t size) {
+  return std::vector<T>(size * size, T(1) / (size * size));
+}
+
+// Side of the Gaussian kernel: 3 sigma on each side of the center
+inline size_t gaussian_size(double sigma) {
+  return 2 * (size_t)std::ceil(3 * sigma) + 1;
+}
+
+// Gaussian of standard deviation sigma, of gaussian_size(sigma) taps per side
+template <typename T>
+std::vector<T> gaussian_kernel(double sigma) {
+  size_t size = gaussian_size(sigma);
+  std::vector<double> g(size);
+  double sum = 0;
+  for(size_t i=0; i<size; i++) {
+    double x = (double)i - (double)(size / 2);
+    g[i] = std::exp(-x * x / (2 * sigma * sigma));
+    sum += g[i];
+  }
+  std::vector<T> kernel(size * size);
+  for(size_t i=0; i<size; i++)
+    for(size_t j=0; j<size; j++)
+      kernel[i*size + j] = g[i] * g[j] / (sum * sum);
+  return kernel;
+}
+
+// Unsharp masking: the image plus amount times its difference with the blurred image
+template <typename T>
+std::vector<T> unsharp_kernel(double sigma, double amount) {
+  std::vector<T> kernel = gaussian_kernel<T>(sigma);
+  for(auto& k : kernel)
+    k = -amount * k;
+  kernel[kernel.size() / 2] += 1 + amount;
+  return kernel;
+}
+
+// Convolution of each channel of a grayscale or RGB image, with the
+// samples rounded and clipped to [0, max]
+template <typename T>
+netpbm convolve(const netpbm& img, const Convolver2D<T>& conv, size_t threads = 0) {
+  if(img.is_baw()) {
+    std::cout << "Only grayscale and RGB images can be convolved." << std::endl;
+    exit(1);
+  }
+  size_t width = img.get_width();
+  size_t height = img.get_height();
+  size_t channels = img.is_rgb() ? 3 : 1;
+  size_t n = width * height;
+  const uint8_t* raster = img.data();
+
+  std::vector<uint8_t> out(img.get_bytes());
+  std::vector<T> plane(n);
+  std::vector<T> result(n);
+  for(size_t ch=0; ch<channels; ch++) {
+    raster_to_plane(raster, n, channels, ch, img.get_depth(), plane.data());
+    conv.apply(plane.data(), result.data(), width, height, threads);
+    plane_to_raster(result.data(), n, channels, ch, img.get_depth(), img.get_max(), out.data());
+  }
+  return netpbm(img.is_rgb() ? "P6" : "P5", width, height, img.get_max(), out.data());
+}
+
+#endif
@@ -2,39 +2,57 @@
 #include <vector>
 
 #include "constants.hpp"
+#include "separable.hpp"
 
 template <typename T>
-void dctII(std::vector<T> x, std::vector<T>& y) {
-  size_t N = x.size();
+void dctII(const T* x, T* y, size_t N) {
   for(size_t k=0; k<N; k++) {
-    y[k] = 0;
+    T acc = 0;
     for(size_t n=0; n<N; n++) {
-      y[k] = x[n] * cos(PI / N * (n + 0.5) * k);
+      acc += x[n] * cos(PI / N * (n + 0.5) * k);
     }
+    y[k] = acc;
   }
 }
 
 template <typename T>
-void dctII_2D(std::vector<std::vector<T>> x, std::vector<std::vector<T>>& y) {
-  size_t w = x[0].size(); 
-  size_t h = x.size(); 
+void dctII(const std::vector<T>& x, std::vector<T>& y) {
+  dctII(x.data(), y.data(), x.size());
+}
+
+// In-place 2D DCT-II of a rows x cols image stored row by row with the given stride
+template <typename T>
+void dctII_2D(T* data, size_t rows, size_t cols, size_t stride, size_t threads = 0) {
+  auto op = [](T* line, size_t n, T* scratch) {
+    dctII(line, scratch, n);
+    std::copy(scratch, scratch + n, line);
+  };
+  separable_2d(data, rows, cols, stride, op, threads);
+}
 
-  // Rows
+template <typename T>
+void dctII_2D(MatrixView<T> v, size_t threads = 0) {
+  auto op = [](T* line, size_t n, T* scratch) {
+    dctII(line, scratch, n);
+    std::copy(scratch, scratch + n, line);
+  };
+  separable_2d(v, op, threads);
+}
+
+template <typename T>
+void dctII_2D(const std::vector<std::vector<T>>& x, std::vector<std::vector<T>>& y) {
+  size_t w = x[0].size();
+  size_t h = x.size();
+
+  // Pack the rows in one contiguous buffer
+  std::vector<T> buf(h * w);
   for(size_t i=0; i<h; i++) {
-    dctII<T>(x[i], y[i]);
+    std::copy(x[i].begin(), x[i].end(), buf.begin() + i*w);
   }
 
-  // Columns
-  std::vector<T> x_sub(h);
-  std::vector<T> y_sub(h);
-  for(size_t i=0; i<w; i++) {
-    // Select one column
-    for(size_t k=0; k<h; k++)
-      x_sub[k] = y[k][i];
+  dctII_2D(buf.data(), h, w, w);
 
-    dctII(x_sub, y_sub);
-
-    for(size_t k=0; k<h; k++)
-      y[k][i] = y_sub[k];
+  for(size_t i=0; i<h; i++) {
+    std::copy(buf.begin() + i*w, buf.begin() + (i+1)*w, y[i].begin());
   }
 }
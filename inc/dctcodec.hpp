@@ -0,0 +1,487 @@
+#ifndef DCTCODEC_H
+#define DCTCODEC_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <bit>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "constants.hpp"
+#include "netpbm.hpp"
+#include "huffman.hpp"
+#include "parallel.hpp"
+
+// Lossy image codec in the way of baseline JPEG, for 8-bit grayscale and
+// RGB netpbm images. RGB is converted to YCbCr (JFIF, no subsampling), each
+// component is cut into 8 x 8 blocks (the edge pixels are repeated to fill
+// the last ones), which go through a DCT, are quantized with the tables of
+// the JPEG standard scaled by a quality in [1, 100], and read in zigzag
+// order. The DC coefficient is coded as the difference to the previous
+// block of the same component, the AC coefficients as (run of zeros, size)
+// symbols, each followed by size raw bits, with Huffman codes built for
+// the image: one table for the DC and one for the AC symbols of the luma,
+// two more for the chroma.
+//
+// A row of blocks (an MCU row) starts from a DC prediction of 0 and is
+// written to its own stream, so that rows are encoded and decoded in
+// parallel, as with a restart marker at each row.
+//
+// Layout, little-endian:
+//   "DCT1", the width and height (4 bytes each), the number of components
+//   (1 byte), the quality (1 byte), the maximum sample value (2 bytes)
+//   the code lengths of each table: 256 lengths on 4 bits
+//   the size of the stream of each row (4 bytes)
+//   the streams
+
+constexpr size_t DCT_HEADER = 16;
+
+// Index in the block of the k-th coefficient in zigzag order
+constexpr uint8_t DCT_ZIGZAG[64] = {
+   0,  1,  8, 16,  9,  2,  3, 10,
+  17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34,
+  27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36,
+  29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46,
+  53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Quantization tables of the JPEG standard (annex K), row by row
+constexpr uint8_t DCT_LUMA_QUANT[64] = {
+  16, 11, 10, 16,  24,  40,  51,  61,
+  12, 12, 14, 19,  26,  58,  60,  55,
+  14, 13, 16, 24,  40,  57,  69,  56,
+  14, 17, 22, 29,  51,  87,  80,  62,
+  18, 22, 37, 56,  68, 109, 103,  77,
+  24, 35, 55, 64,  81, 104, 113,  92,
+  49, 64, 78, 87, 103, 121, 120, 101,
+  72, 92, 95, 98, 112, 100, 103,  99
+};
+
+constexpr uint8_t DCT_CHROMA_QUANT[64] = {
+  17, 18, 24, 47, 99, 99, 99, 99,
+  18, 21, 26, 66, 99, 99, 99, 99,
+  24, 26, 56, 99, 99, 99, 99, 99,
+  47, 66, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// 8-point DCT-II of the values p[0], p[stride], ..., p[7 stride], in
+// place, by the Arai-Agui-Nakajima factorization (5 multiplications). The
+// outputs are scaled: output k is 2 sqrt(2) a(k) times the orthonormal
+// one, with a(0) = 1 and a(k) = sqrt(2) cos(k pi / 16).
+inline void aan_dct8(float* p, size_t stride) {
+  float tmp0 = p[0] + p[7*stride];
+  float tmp7 = p[0] - p[7*stride];
+  float tmp1 = p[stride] + p[6*stride];
+  float tmp6 = p[stride] - p[6*stride];
+  float tmp2 = p[2*stride] + p[5*stride];
+  float tmp5 = p[2*stride] - p[5*stride];
+  float tmp3 = p[3*stride] + p[4*stride];
+  float tmp4 = p[3*stride] - p[4*stride];
+
+  // Even part
+  float tmp10 = tmp0 + tmp3;
+  float tmp13 = tmp0 - tmp3;
+  float tmp11 = tmp1 + tmp2;
+  float tmp12 = tmp1 - tmp2;
+  p[0] = tmp10 + tmp11;
+  p[4*stride] = tmp10 - tmp11;
+  float z1 = (tmp12 + tmp13) * 0.707106781f;
+  p[2*stride] = tmp13 + z1;
+  p[6*stride] = tmp13 - z1;
+
+  // Odd part
+  tmp10 = tmp4 + tmp5;
+  tmp11 = tmp5 + tmp6;
+  tmp12 = tmp6 + tmp7;
+  float z5 = (tmp10 - tmp12) * 0.382683433f;
+  float z2 = 0.541196100f * tmp10 + z5;
+  float z4 = 1.306562965f * tmp12 + z5;
+  float z3 = tmp11 * 0.707106781f;
+  float z11 = tmp7 + z3;
+  float z13 = tmp7 - z3;
+  p[5*stride] = z13 + z2;
+  p[3*stride] = z13 - z2;
+  p[stride] = z11 + z4;
+  p[7*stride] = z11 - z4;
+}
+
+// Inverse 8-point DCT by the same factorization: when input k is a(k)
+// times the orthonormal coefficient, the outputs are 2 sqrt(2) times the
+// values
+inline void aan_idct8(float* p, size_t stride) {
+  // Even part
+  float tmp10 = p[0] + p[4*stride];
+  float tmp11 = p[0] - p[4*stride];
+  float tmp13 = p[2*stride] + p[6*stride];
+  float tmp12 = (p[2*stride] - p[6*stride]) * 1.414213562f - tmp13;
+  float tmp0 = tmp10 + tmp13;
+  float tmp3 = tmp10 - tmp13;
+  float tmp1 = tmp11 + tmp12;
+  float tmp2 = tmp11 - tmp12;
+
+  // Odd part
+  float z13 = p[5*stride] + p[3*stride];
+  float z10 = p[5*stride] - p[3*stride];
+  float z11 = p[stride] + p[7*stride];
+  float z12 = p[stride] - p[7*stride];
+  float tmp7 = z11 + z13;
+  tmp11 = (z11 - z13) * 1.414213562f;
+  float z5 = (z10 + z12) * 1.847759065f;
+  tmp10 = 1.082392200f * z12 - z5;
+  tmp12 = -2.613125930f * z10 + z5;
+  float tmp6 = tmp12 - tmp7;
+  float tmp5 = tmp11 - tmp6;
+  float tmp4 = tmp10 + tmp5;
+
+  p[0] = tmp0 + tmp7;
+  p[7*stride] = tmp0 - tmp7;
+  p[stride] = tmp1 + tmp6;
+  p[6*stride] = tmp1 - tmp6;
+  p[2*stride] = tmp2 + tmp5;
+  p[5*stride] = tmp2 - tmp5;
+  p[4*stride] = tmp3 + tmp4;
+  p[3*stride] = tmp3 - tmp4;
+}
+
+// a(u) a(v), for the scaling of the 2D transforms
+inline const float* aan_scales() {
+  static const std::vector<float> scales = [] {
+    std::vector<float> a(8);
+    std::vector<float> s(64);
+    for(size_t k=0; k<8; k++)
+      a[k] = (k == 0) ? 1 : std::sqrt(2.0) * std::cos(k * PI / 16);
+    for(size_t u=0; u<8; u++)
+      for(size_t v=0; v<8; v++)
+        s[8*u + v] = a[u] * a[v];
+    return s;
+  }();
+  return scales.data();
+}
+
+// Orthonormal 2D DCT of an 8 x 8 block (the scaling of the JPEG DCT), rows
+// then columns
+inline void dct_8x8(const float* in, float* out) {
+  const float* scale = aan_scales();
+  std::copy(in, in + 64, out);
+  for(size_t y=0; y<8; y++)
+    aan_dct8(out + 8*y, 1);
+  for(size_t x=0; x<8; x++)
+    aan_dct8(out + x, 8);
+  for(size_t k=0; k<64; k++)
+    out[k] /= 8 * scale[k];
+}
+
+inline void idct_8x8(const float* in, float* out) {
+  const float* scale = aan_scales();
+  for(size_t k=0; k<64; k++)
+    out[k] = in[k] * scale[k] / 8;
+  for(size_t x=0; x<8; x++)
+    aan_idct8(out + x, 8);
+  for(size_t y=0; y<8; y++)
+    aan_idct8(out + 8*y, 1);
+}
+
+// Quantization steps in zigzag order for a quality in [1, 100], scaled as
+// in the IJG library (quality 50 gives the table, 100 gives steps of 1)
+inline void dct_quant_steps(const uint8_t* table, size_t quality, float* steps) {
+  quality = std::clamp<size_t>(quality, 1, 100);
+  size_t scale = (quality < 50) ? 5000 / quality : 200 - 2 * quality;
+  for(size_t k=0; k<64; k++)
+    steps[k] = std::clamp<size_t>((table[DCT_ZIGZAG[k]] * scale + 50) / 100, 1, 255);
+}
+
+// Bits of the magnitude of v, and the JPEG raw bits of v on that many bits
+// (v itself when positive, v - 1 when negative)
+inline size_t dct_size(int v) {
+  return std::bit_width((unsigned)std::abs(v));
+}
+
+inline uint32_t dct_raw_bits(int v, size_t size) {
+  return (v >= 0) ? v : v + (1 << size) - 1;
+}
+
+inline int dct_extend(uint32_t bits, size_t size) {
+  if(size == 0)
+    return 0;
+  return (bits < ((uint32_t)1 << (size - 1))) ? (int)bits - (1 << size) + 1 : (int)bits;
+}
+
+// Symbols of a block of quantized coefficients in zigzag order, given to
+// sink(table, symbol, raw bits, number of raw bits)
+template <typename Sink>
+void dct_code_block(const int16_t* zz, int& prediction, size_t dc_table, size_t ac_table, Sink& sink) {
+  int diff = zz[0] - prediction;
+  prediction = zz[0];
+  size_t size = dct_size(diff);
+  sink(dc_table, size, dct_raw_bits(diff, size), size);
+
+  size_t run = 0;
+  for(size_t k=1; k<64; k++) {
+    if(zz[k] == 0) {
+      run++;
+      continue;
+    }
+    // Runs of 16 zeros
+    for(; run>15; run-=16)
+      sink(ac_table, 0xF0, 0, 0);
+    size = dct_size(zz[k]);
+    sink(ac_table, run << 4 | size, dct_raw_bits(zz[k], size), size);
+    run = 0;
+  }
+  // End of block
+  if(run > 0)
+    sink(ac_table, 0x00, 0, 0);
+}
+
+inline std::vector<uint8_t> dct_encode(const netpbm& img, size_t quality = 75, size_t threads = 0) {
+  if(img.is_baw() || img.get_depth() != 1) {
+    std::cout << "Only 8-bit grayscale and RGB images can be coded." << std::endl;
+    exit(1);
+  }
+  size_t width = img.get_width();
+  size_t height = img.get_height();
+  size_t comps = img.is_rgb() ? 3 : 1;
+  size_t tables = (comps == 1) ? 2 : 4;
+  size_t bw = (width + 7) / 8;
+  size_t bh = (height + 7) / 8;
+  size_t stride = 8 * bw;
+  const uint8_t* raster = img.data();
+
+  float steps[2][64];
+  dct_quant_steps(DCT_LUMA_QUANT, quality, steps[0]);
+  dct_quant_steps(DCT_CHROMA_QUANT, quality, steps[1]);
+  float inverse[2][64];
+  for(size_t k=0; k<64; k++) {
+    inverse[0][k] = 1 / steps[0][k];
+    inverse[1][k] = 1 / steps[1][k];
+  }
+
+  // Quantized coefficients of each block of each row, components
+  // interleaved, and the symbol counts of each worker
+  std::vector<int16_t> coefs(bh * bw * comps * 64);
+  size_t workers = num_threads(threads);
+  std::vector<std::vector<uint64_t>> freq(workers, std::vector<uint64_t>(4 * 256, 0));
+
+  parallel_tasks(bh, [&](size_t row, size_t worker) {
+    // Level-shifted components of the 8 lines of the row
+    std::vector<float> strip(comps * 8 * stride);
+    for(size_t y=0; y<8; y++) {
+      const uint8_t* line = raster + std::min(8*row + y, height - 1) * width * comps;
+      for(size_t x=0; x<stride; x++) {
+        const uint8_t* p = line + std::min(x, width - 1) * comps;
+        if(comps == 1) {
+          strip[y*stride + x] = p[0] - 128.0f;
+        }
+        else {
+          float r = p[0];
+          float g = p[1];
+          float b = p[2];
+          strip[y*stride + x] = 0.299f * r + 0.587f * g + 0.114f * b - 128;
+          strip[(8 + y)*stride + x] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+          strip[(16 + y)*stride + x] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+        }
+      }
+    }
+
+    float block[64];
+    float F[64];
+    int prediction[3] = {0, 0, 0};
+    auto count = [&](size_t table, uint32_t symbol, uint32_t, size_t) {
+      freq[worker][256*table + symbol]++;
+    };
+    for(size_t bx=0; bx<bw; bx++) {
+      for(size_t c=0; c<comps; c++) {
+        for(size_t y=0; y<8; y++)
+          for(size_t x=0; x<8; x++)
+            block[8*y + x] = strip[(8*c + y)*stride + 8*bx + x];
+        dct_8x8(block, F);
+        const float* inv = inverse[c > 0];
+        int16_t* zz = coefs.data() + ((row * bw + bx) * comps + c) * 64;
+        for(size_t k=0; k<64; k++)
+          zz[k] = std::clamp<long>(std::lrint(F[DCT_ZIGZAG[k]] * inv[k]), (k == 0) ? -1024 : -1023, 1023);
+        dct_code_block(zz, prediction[c], 2*(c > 0), 2*(c > 0) + 1, count);
+      }
+    }
+  }, threads);
+
+  // Codes of the image
+  std::vector<uint64_t> total(256);
+  std::vector<std::vector<uint8_t>> lengths(tables, std::vector<uint8_t>(256));
+  std::vector<std::vector<uint32_t>> codes(tables);
+  HuffmanBuilder builder;
+  for(size_t t=0; t<tables; t++) {
+    std::fill(total.begin(), total.end(), 0);
+    for(auto& f : freq)
+      for(size_t s=0; s<256; s++)
+        total[s] += f[256*t + s];
+    builder.build(total.data(), 256, HUFFMAN_MAX_BITS, lengths[t].data());
+    codes[t] = canonical_codes(lengths[t]);
+  }
+
+  std::vector<std::vector<uint8_t>> streams(bh);
+  parallel_tasks(bh, [&](size_t row, size_t) {
+    BitWriter writer(bw * comps * 64);
+    int prediction[3] = {0, 0, 0};
+    auto write = [&](size_t table, uint32_t symbol, uint32_t bits, size_t n) {
+      writer.put(codes[table][symbol], lengths[table][symbol]);
+      writer.put(bits, n);
+    };
+    for(size_t bx=0; bx<bw; bx++)
+      for(size_t c=0; c<comps; c++)
+        dct_code_block(coefs.data() + ((row * bw + bx) * comps + c) * 64, prediction[c], 2*(c > 0), 2*(c > 0) + 1, write);
+    streams[row] = writer.finish();
+  }, threads);
+
+  size_t header = DCT_HEADER + tables * 128 + bh * 4;
+  size_t size = header;
+  for(auto& s : streams)
+    size += s.size();
+  uint8_t head[DCT_HEADER];
+  memcpy(head, "DCT1", 4);
+  store_le32(head + 4, width);
+  store_le32(head + 8, height);
+  head[12] = comps;
+  head[13] = std::clamp<size_t>(quality, 1, 100);
+  head[14] = img.get_max() & 0xFF;
+  head[15] = img.get_max() >> 8;
+  std::vector<uint8_t> out(size, 0);
+  std::copy(head, head + DCT_HEADER, out.begin());
+  for(size_t t=0; t<tables; t++)
+    for(size_t s=0; s<256; s++)
+      out[DCT_HEADER + 128*t + s/2] |= lengths[t][s] << (4 * (s % 2));
+  size_t offset = header;
+  for(size_t row=0; row<bh; row++) {
+    store_le32(out.data() + DCT_HEADER + tables * 128 + 4*row, streams[row].size());
+    std::copy(streams[row].begin(), streams[row].end(), out.begin() + offset);
+    offset += streams[row].size();
+  }
+  return out;
+}
+
+inline netpbm dct_decode(const uint8_t* data, size_t size, size_t threads = 0) {
+  if(size < DCT_HEADER || memcmp(data, "DCT1", 4) != 0) {
+    std::cout << "The data is not a DCT coded image." << std::endl;
+    exit(1);
+  }
+  size_t width = load_le32(data + 4);
+  size_t height = load_le32(data + 8);
+  size_t comps = data[12];
+  size_t quality = data[13];
+  int max = data[14] | data[15] << 8;
+  if(width == 0 || height == 0 || (comps != 1 && comps != 3) || max == 0 || max > 255) {
+    std::cout << "The header of the DCT coded image is invalid." << std::endl;
+    exit(1);
+  }
+  size_t tables = (comps == 1) ? 2 : 4;
+  size_t bw = (width + 7) / 8;
+  size_t bh = (height + 7) / 8;
+  size_t stride = 8 * bw;
+  size_t header = DCT_HEADER + tables * 128 + bh * 4;
+  if(size < header) {
+    std::cout << "The DCT coded image is truncated." << std::endl;
+    exit(1);
+  }
+
+  std::vector<HuffmanDecoder> decoders;
+  for(size_t t=0; t<tables; t++) {
+    std::vector<uint8_t> lengths(256);
+    for(size_t s=0; s<256; s++)
+      lengths[s] = (data[DCT_HEADER + 128*t + s/2] >> (4 * (s % 2))) & 0xF;
+    decoders.emplace_back(lengths);
+  }
+  float steps[2][64];
+  dct_quant_steps(DCT_LUMA_QUANT, quality, steps[0]);
+  dct_quant_steps(DCT_CHROMA_QUANT, quality, steps[1]);
+
+  std::vector<size_t> offsets(bh + 1, header);
+  for(size_t row=0; row<bh; row++) {
+    offsets[row + 1] = offsets[row] + load_le32(data + DCT_HEADER + tables * 128 + 4*row);
+    if(offsets[row + 1] > size) {
+      std::cout << "The DCT coded image is truncated." << std::endl;
+      exit(1);
+    }
+  }
+
+  std::vector<uint8_t> raster(width * height * comps);
+  parallel_tasks(bh, [&](size_t row, size_t) {
+    BitReader reader(data + offsets[row], offsets[row + 1] - offsets[row]);
+    std::vector<float> strip(comps * 8 * stride);
+    float F[64];
+    float block[64];
+    int prediction[3] = {0, 0, 0};
+    for(size_t bx=0; bx<bw; bx++) {
+      for(size_t c=0; c<comps; c++) {
+        const HuffmanDecoder& dc = decoders[2*(c > 0)];
+        const HuffmanDecoder& ac = decoders[2*(c > 0) + 1];
+        const float* step = steps[c > 0];
+        std::fill(F, F + 64, 0.0f);
+
+        reader.refill();
+        size_t n = dc.decode(reader);
+        if(n > 11) {
+          std::cout << "Invalid DC coefficient in the DCT coded image." << std::endl;
+          exit(1);
+        }
+        prediction[c] += dct_extend(reader.get(n), n);
+        F[0] = prediction[c] * step[0];
+        for(size_t k=1; k<64; k++) {
+          reader.refill();
+          uint32_t symbol = ac.decode(reader);
+          size_t run = symbol >> 4;
+          n = symbol & 0xF;
+          if(n == 0) {
+            if(run != 15)
+              break; // End of block
+            k += 15;
+            continue;
+          }
+          k += run;
+          if(k > 63 || n > 10) {
+            std::cout << "Invalid AC coefficient in the DCT coded image." << std::endl;
+            exit(1);
+          }
+          F[DCT_ZIGZAG[k]] = dct_extend(reader.get(n), n) * step[k];
+        }
+        idct_8x8(F, block);
+        for(size_t y=0; y<8; y++)
+          for(size_t x=0; x<8; x++)
+            strip[(8*c + y)*stride + 8*bx + x] = block[8*y + x];
+      }
+    }
+    if(reader.overrun()) {
+      std::cout << "The DCT coded image is truncated." << std::endl;
+      exit(1);
+    }
+
+    float top = max;
+    for(size_t y=0; y<8 && 8*row+y<height; y++) {
+      uint8_t* line = raster.data() + (8*row + y) * width * comps;
+      for(size_t x=0; x<width; x++) {
+        float Y = strip[y*stride + x] + 128;
+        if(comps == 1) {
+          line[x] = std::clamp(Y, 0.0f, top) + 0.5f;
+          continue;
+        }
+        float cb = strip[(8 + y)*stride + x];
+        float cr = strip[(16 + y)*stride + x];
+        line[3*x]     = std::clamp(Y + 1.402f * cr, 0.0f, top) + 0.5f;
+        line[3*x + 1] = std::clamp(Y - 0.344136f * cb - 0.714136f * cr, 0.0f, top) + 0.5f;
+        line[3*x + 2] = std::clamp(Y + 1.772f * cb, 0.0f, top) + 0.5f;
+      }
+    }
+  }, threads);
+
+  return netpbm((comps == 3) ? "P6" : "P5", width, height, max, raster.data());
+}
+
+#endif
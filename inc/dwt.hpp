@@ -0,0 +1,191 @@
+#ifndef DWT_H
+#define DWT_H
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "separable.hpp"
+
+// Discrete wavelet transforms by lifting. One level splits a signal of n
+// samples into ceil(n/2) approximation coefficients followed by n/2 detail
+// coefficients, in place. Several levels transform the approximation again
+// (Mallat layout). The signal is extended symmetrically at both ends (the
+// border sample is not repeated), so any length works.
+//
+// The even and odd samples are first separated, then each lifting step
+// updates one half from the other one with contiguous loops that the
+// compiler can vectorize. The low-pass filters have a gain of 1 at DC and
+// the high-pass filters a gain of 2 at Nyquist, so the approximation of an
+// image stays in the range of its pixels.
+//   Haar:     d -= s, s += d/2
+//   CDF 5/3:  d -= (s + s')/2, s += (d + d')/4 (LeGall, as in lossless JPEG 2000)
+//   CDF 9/7:  four lifting steps and a scaling (as in lossy JPEG 2000)
+
+enum class Wavelet { haar, cdf53, cdf97 };
+
+// CDF 9/7 lifting coefficients and scaling
+constexpr double CDF97_ALPHA = -1.586134342059924;
+constexpr double CDF97_BETA  = -0.052980118572961;
+constexpr double CDF97_GAMMA =  0.882911075530934;
+constexpr double CDF97_DELTA =  0.443506852043971;
+constexpr double CDF97_K     =  1.230174104914001;
+
+// d[i] += a (s[i] + s[i+1]), with s[ns] = s[ns-1] when n is even
+template <typename T>
+void lift_predict(const T* s, size_t ns, T* d, size_t nd, T a) {
+  size_t m = (ns > nd) ? nd : nd - 1;
+  for(size_t i=0; i<m; i++)
+    d[i] += a * (s[i] + s[i + 1]);
+  if(m < nd)
+    d[nd - 1] += 2 * a * s[ns - 1];
+}
+
+// s[i] += b (d[i-1] + d[i]), with d[-1] = d[0] and d[nd] = d[nd-1] when n is odd
+template <typename T>
+void lift_update(T* s, size_t ns, const T* d, size_t nd, T b) {
+  s[0] += 2 * b * d[0];
+  for(size_t i=1; i<nd; i++)
+    s[i] += b * (d[i - 1] + d[i]);
+  if(ns > nd && nd > 0)
+    s[ns - 1] += 2 * b * d[nd - 1];
+}
+
+template <typename T>
+void scale_line(T* x, size_t n, T k) {
+  for(size_t i=0; i<n; i++)
+    x[i] *= k;
+}
+
+// One level of the forward transform of x[0 .. n-1], in place
+template <typename T>
+void dwt_level(T* x, size_t n, Wavelet w, T* scratch) {
+  if(n < 2)
+    return;
+  size_t ns = (n + 1) / 2;
+  size_t nd = n / 2;
+
+  // Even samples, then odd samples
+  for(size_t i=0; i<ns; i++)
+    scratch[i] = x[2*i];
+  for(size_t i=0; i<nd; i++)
+    scratch[ns + i] = x[2*i + 1];
+  std::copy(scratch, scratch + n, x);
+  T* s = x;
+  T* d = x + ns;
+
+  switch(w) {
+    case Wavelet::haar:
+      for(size_t i=0; i<nd; i++)
+        d[i] -= s[i];
+      for(size_t i=0; i<nd; i++)
+        s[i] += d[i] / 2;
+      break;
+    case Wavelet::cdf53:
+      lift_predict<T>(s, ns, d, nd, -0.5);
+      lift_update<T>(s, ns, d, nd, 0.25);
+      break;
+    case Wavelet::cdf97:
+      lift_predict<T>(s, ns, d, nd, CDF97_ALPHA);
+      lift_update<T>(s, ns, d, nd, CDF97_BETA);
+      lift_predict<T>(s, ns, d, nd, CDF97_GAMMA);
+      lift_update<T>(s, ns, d, nd, CDF97_DELTA);
+      scale_line<T>(s, ns, 1 / CDF97_K);
+      scale_line<T>(d, nd, CDF97_K);
+      break;
+  }
+}
+
+// One level of the inverse transform: the lifting steps undone in reverse order
+template <typename T>
+void idwt_level(T* x, size_t n, Wavelet w, T* scratch) {
+  if(n < 2)
+    return;
+  size_t ns = (n + 1) / 2;
+  size_t nd = n / 2;
+  T* s = x;
+  T* d = x + ns;
+
+  switch(w) {
+    case Wavelet::haar:
+      for(size_t i=0; i<nd; i++)
+        s[i] -= d[i] / 2;
+      for(size_t i=0; i<nd; i++)
+        d[i] += s[i];
+      break;
+    case Wavelet::cdf53:
+      lift_update<T>(s, ns, d, nd, -0.25);
+      lift_predict<T>(s, ns, d, nd, 0.5);
+      break;
+    case Wavelet::cdf97:
+      scale_line<T>(s, ns, CDF97_K);
+      scale_line<T>(d, nd, 1 / CDF97_K);
+      lift_update<T>(s, ns, d, nd, -CDF97_DELTA);
+      lift_predict<T>(s, ns, d, nd, -CDF97_GAMMA);
+      lift_update<T>(s, ns, d, nd, -CDF97_BETA);
+      lift_predict<T>(s, ns, d, nd, -CDF97_ALPHA);
+      break;
+  }
+
+  // Interleave the halves back
+  for(size_t i=0; i<ns; i++)
+    scratch[2*i] = s[i];
+  for(size_t i=0; i<nd; i++)
+    scratch[2*i + 1] = d[i];
+  std::copy(scratch, scratch + n, x);
+}
+
+// Length of the approximation after the given number of levels
+inline size_t dwt_length(size_t n, size_t levels) {
+  for(size_t l=0; l<levels; l++)
+    n = (n + 1) / 2;
+  return n;
+}
+
+// Multilevel transforms of a signal, in place
+template <typename T>
+void dwt(T* x, size_t n, Wavelet w, size_t levels = 1) {
+  std::vector<T> scratch(n);
+  for(size_t l=0; l<levels; l++)
+    dwt_level(x, dwt_length(n, l), w, scratch.data());
+}
+
+template <typename T>
+void idwt(T* x, size_t n, Wavelet w, size_t levels = 1) {
+  std::vector<T> scratch(n);
+  for(size_t l=levels; l>0; l--)
+    idwt_level(x, dwt_length(n, l - 1), w, scratch.data());
+}
+
+template <typename T>
+void dwt(std::vector<T>& x, Wavelet w, size_t levels = 1) {
+  dwt(x.data(), x.size(), w, levels);
+}
+
+template <typename T>
+void idwt(std::vector<T>& x, Wavelet w, size_t levels = 1) {
+  idwt(x.data(), x.size(), w, levels);
+}
+
+// In-place multilevel 2D transforms of a rows x cols image stored row by row
+// with the given stride. Each level transforms the rows, then the columns (in
+// strips of columns, see separable.hpp) of the top-left approximation.
+template <typename T>
+void dwt_2D(T* data, size_t rows, size_t cols, size_t stride, Wavelet w, size_t levels = 1, size_t threads = 0) {
+  auto op = [w](T* line, size_t n, T* scratch) {
+    dwt_level(line, n, w, scratch);
+  };
+  for(size_t l=0; l<levels; l++)
+    separable_2d(data, dwt_length(rows, l), dwt_length(cols, l), stride, op, threads);
+}
+
+template <typename T>
+void idwt_2D(T* data, size_t rows, size_t cols, size_t stride, Wavelet w, size_t levels = 1, size_t threads = 0) {
+  auto op = [w](T* line, size_t n, T* scratch) {
+    idwt_level(line, n, w, scratch);
+  };
+  for(size_t l=levels; l>0; l--)
+    separable_2d(data, dwt_length(rows, l - 1), dwt_length(cols, l - 1), stride, op, threads);
+}
+
+#endif
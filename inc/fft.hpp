@@ -1,10 +1,15 @@
+#ifndef FFT_H
+#define FFT_H
+
 #include <vector>
 #include <cmath>
 #include <chrono>
 #include <fstream>
+#include <memory>
 
 #include "complex.hpp"
 #include "constants.hpp"
+#include "separable.hpp"
 
 template <typename T>
 Cpx<T> get_twiddle(size_t N, double kn) {
@@ -232,9 +237,7 @@ std::unique_ptr<Bfly<T>> get_butterfly(size_t size) {
 }
 
 template <typename T>
-void fft(Cpx<T>* data, size_t N, size_t r, bool inverse) {
-  std::unique_ptr<Bfly<T>> b_ptr = get_butterfly<T>(r);
-
+void fft(Cpx<T>* data, size_t N, size_t r, Bfly<T>* b_ptr, bool inverse) {
   for(size_t s=1; s<N; s = s*r) {
     // Radix 2:
     //   Stage #1: N2=1 set of N1=N/2 bfly2
@@ -274,7 +277,13 @@ void fft(Cpx<T>* data, size_t N, size_t r, bool inverse) {
 }
 
 template <typename T>
-void reverse_reorder(std::vector<Cpx<T>>& x, size_t N, size_t r) {
+void fft(Cpx<T>* data, size_t N, size_t r, bool inverse) {
+  std::unique_ptr<Bfly<T>> b_ptr = get_butterfly<T>(r);
+  fft(data, N, r, b_ptr.get(), inverse);
+}
+
+template <typename T>
+void reverse_reorder(Cpx<T>* x, size_t N, size_t r) {
   Cpx<T> tmp;
   for(size_t idx_src=1; idx_src<N-1; idx_src++) { // 1st and last never change
     size_t i=1; size_t j=N/r;
@@ -290,3 +299,37 @@ void reverse_reorder(std::vector<Cpx<T>>& x, size_t N, size_t r) {
     }
   }
 }
+
+template <typename T>
+void reverse_reorder(std::vector<Cpx<T>>& x, size_t N, size_t r) {
+  reverse_reorder(x.data(), N, r);
+}
+
+// In-place 2D FFT of a rows x cols image stored row by row with the given stride.
+// Both rows and cols must be powers of r. The output is in natural order.
+template <typename T>
+void fft_2D(Cpx<T>* data, size_t rows, size_t cols, size_t stride, size_t r, bool inverse, size_t threads = 0) {
+  // The butterflies hold no state, so one instance is shared by all the threads
+  std::unique_ptr<Bfly<T>> b_ptr = get_butterfly<T>(r);
+  Bfly<T>* b = b_ptr.get();
+
+  auto op = [=](Cpx<T>* line, size_t n, Cpx<T>*) {
+    fft(line, n, r, b, inverse);
+    reverse_reorder(line, n, r);
+  };
+  separable_2d(data, rows, cols, stride, op, threads);
+}
+
+template <typename T>
+void fft_2D(MatrixView<Cpx<T>> v, size_t r, bool inverse, size_t threads = 0) {
+  std::unique_ptr<Bfly<T>> b_ptr = get_butterfly<T>(r);
+  Bfly<T>* b = b_ptr.get();
+
+  auto op = [=](Cpx<T>* line, size_t n, Cpx<T>*) {
+    fft(line, n, r, b, inverse);
+    reverse_reorder(line, n, r);
+  };
+  separable_2d(v, op, threads);
+}
+
+#endif
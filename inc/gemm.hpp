@@ -0,0 +1,183 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "parallel.hpp"
+
+// Dense matrix products on strided buffers: element (i, j) of a matrix X
+// is X[i*rs + j*cs], so row-major, column-major and transposed operands
+// are all handled by the same routines.
+
+// Register block of the micro-kernel (MR x NR accumulators)
+constexpr size_t GEMM_MR = 4;
+constexpr size_t GEMM_NR = 8;
+
+// Cache blocks: a KC x NR sliver of B stays in L1, an MC x KC block of A
+// in L2 and a KC x NC panel of B in L3
+constexpr size_t GEMM_KC = 256;
+constexpr size_t GEMM_MC = 96;
+constexpr size_t GEMM_NC = 2048;
+
+// Below these sizes (M*N*K) packing does not pay off / threads are not started
+constexpr size_t GEMM_MIN_PACKED = 1 << 15;
+constexpr size_t GEMM_MIN_PARALLEL = 1 << 21;
+
+// Pack an mc x kc block of A in slivers of MR rows: sliver s holds
+// A(s*MR + i, k) at [s*MR*kc + k*MR + i], padded with zeros
+template <typename T>
+void gemm_pack_a(size_t mc, size_t kc, const T* A, size_t rsa, size_t csa, T* buf) {
+  for(size_t i0=0; i0<mc; i0+=GEMM_MR) {
+    size_t m = std::min(GEMM_MR, mc - i0);
+    for(size_t k=0; k<kc; k++) {
+      for(size_t i=0; i<GEMM_MR; i++) {
+        buf[k*GEMM_MR + i] = (i < m) ? A[(i0 + i)*rsa + k*csa] : T(0);
+      }
+    }
+    buf += GEMM_MR * kc;
+  }
+}
+
+// Pack a kc x nc panel of B in slivers of NR columns: sliver s holds
+// B(k, s*NR + j) at [s*NR*kc + k*NR + j], padded with zeros
+template <typename T>
+void gemm_pack_b(size_t kc, size_t nc, const T* B, size_t rsb, size_t csb, T* buf) {
+  for(size_t j0=0; j0<nc; j0+=GEMM_NR) {
+    size_t n = std::min(GEMM_NR, nc - j0);
+    for(size_t k=0; k<kc; k++) {
+      for(size_t j=0; j<GEMM_NR; j++) {
+        buf[k*GEMM_NR + j] = (j < n) ? B[k*rsb + (j0 + j)*csb] : T(0);
+      }
+    }
+    buf += GEMM_NR * kc;
+  }
+}
+
+// C(m x n) += A sliver * B sliver, with m <= MR and n <= NR
+template <typename T>
+void gemm_micro_kernel(size_t kc, const T* a, const T* b, T* C, size_t rsc, size_t csc, size_t m, size_t n) {
+  T acc[GEMM_MR][GEMM_NR] = {};
+
+  for(size_t k=0; k<kc; k++) {
+    for(size_t i=0; i<GEMM_MR; i++) {
+      T a_i = a[k*GEMM_MR + i];
+      for(size_t j=0; j<GEMM_NR; j++) {
+        acc[i][j] += a_i * b[k*GEMM_NR + j];
+      }
+    }
+  }
+
+  for(size_t i=0; i<m; i++) {
+    for(size_t j=0; j<n; j++) {
+      C[i*rsc + j*csc] += acc[i][j];
+    }
+  }
+}
+
+// C (M x N) = A (M x K) * B (K x N) + beta * C
+template <typename T>
+void gemm(size_t M, size_t N, size_t K,
+          const T* A, size_t rsa, size_t csa,
+          const T* B, size_t rsb, size_t csb,
+          T* C, size_t rsc, size_t csc,
+          T beta = 0, size_t threads = 0) {
+  // C = beta * C, then only accumulate
+  for(size_t i=0; i<M; i++) {
+    for(size_t j=0; j<N; j++) {
+      T& c = C[i*rsc + j*csc];
+      c = (beta == T(0)) ? T(0) : beta * c;
+    }
+  }
+
+  if(M * N * K < GEMM_MIN_PACKED) {
+    // Small product: plain loops, k in the middle so B and C are walked by rows
+    for(size_t i=0; i<M; i++) {
+      for(size_t k=0; k<K; k++) {
+        T a = A[i*rsa + k*csa];
+        for(size_t j=0; j<N; j++) {
+          C[i*rsc + j*csc] += a * B[k*rsb + j*csb];
+        }
+      }
+    }
+    return;
+  }
+
+  size_t T_num = (M * N * K < GEMM_MIN_PARALLEL) ? 1 : num_threads(threads);
+  std::vector<T> b_buf(GEMM_KC * (GEMM_NC + GEMM_NR));
+
+  for(size_t jc=0; jc<N; jc+=GEMM_NC) {
+    size_t nc = std::min(GEMM_NC, N - jc);
+
+    for(size_t pc=0; pc<K; pc+=GEMM_KC) {
+      size_t kc = std::min(GEMM_KC, K - pc);
+
+      // The panel of B is packed once and shared by all the threads
+      gemm_pack_b(kc, nc, B + pc*rsb + jc*csb, rsb, csb, b_buf.data());
+
+      // Each thread takes a range of MC row blocks of A and C
+      size_t blocks = (M + GEMM_MC - 1) / GEMM_MC;
+      parallel_for(blocks, [&](size_t begin, size_t end) {
+        std::vector<T> a_buf(GEMM_MC * GEMM_KC);
+        for(size_t blk=begin; blk<end; blk++) {
+          size_t ic = blk * GEMM_MC;
+          size_t mc = std::min(GEMM_MC, M - ic);
+          gemm_pack_a(mc, kc, A + ic*rsa + pc*csa, rsa, csa, a_buf.data());
+
+          for(size_t jr=0; jr<nc; jr+=GEMM_NR) {
+            for(size_t ir=0; ir<mc; ir+=GEMM_MR) {
+              gemm_micro_kernel(kc,
+                                a_buf.data() + ir*kc,
+                                b_buf.data() + jr*kc,
+                                C + (ic + ir)*rsc + (jc + jr)*csc, rsc, csc,
+                                std::min(GEMM_MR, mc - ir),
+                                std::min(GEMM_NR, nc - jr));
+            }
+          }
+        }
+      }, T_num);
+    }
+  }
+}
+
+// y (M) = A (M x N) * x (N)
+template <typename T>
+void gemv(size_t M, size_t N, const T* A, size_t rsa, size_t csa, const T* x, T* y, size_t threads = 0) {
+  size_t T_num = (M * N < GEMM_MIN_PARALLEL) ? 1 : num_threads(threads);
+
+  parallel_for(M, [&](size_t begin, size_t end) {
+    if(csa == 1) {
+      // Rows are contiguous: dot products with independent partial sums
+      const size_t L = 8;
+      for(size_t i=begin; i<end; i++) {
+        const T* a = A + i*rsa;
+        T acc[L] = {};
+        size_t j = 0;
+        for(; j+L<=N; j+=L) {
+          for(size_t l=0; l<L; l++)
+            acc[l] += a[j + l] * x[j + l];
+        }
+        T sum = 0;
+        for(; j<N; j++)
+          sum += a[j] * x[j];
+        for(size_t l=0; l<L; l++)
+          sum += acc[l];
+        y[i] = sum;
+      }
+    }
+    else {
+      // Columns are contiguous (or generic strides): y += x_j * column j
+      for(size_t i=begin; i<end; i++)
+        y[i] = 0;
+      for(size_t j=0; j<N; j++) {
+        T x_j = x[j];
+        const T* a = A + j*csa;
+        for(size_t i=begin; i<end; i++)
+          y[i] += a[i*rsa] * x_j;
+      }
+    }
+  }, T_num);
+}
+
+#endif
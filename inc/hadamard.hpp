@@ -4,44 +4,227 @@
 #include <iostream>
 
 #include "matrix.hpp"
+#include "kronecker.hpp"
 #include "random.hpp"
 #include "constants.hpp"
+#include "separable.hpp"
 
-Matrix<double> walsh_hadamard_matrix(size_t N) {
-  // H1  
+inline Matrix<double> walsh_hadamard_factor() {
+  // H1
   Matrix<double> H1(2, 2);
   H1.set(0, 0, 1);
   H1.set(0, 1, 1);
   H1.set(1, 0, 1);
   H1.set(1, 1, -1);
   H1 = H1 * INVSQRT2;
+  return H1;
+}
 
-  std::vector<Matrix<double>> mat_vector;
-  Matrix<double> * Hptr;
-  mat_vector.push_back(H1);
+// Materialized N x N matrix: O(N^2) memory, prefer walsh_hadamard_operator
+inline Matrix<double> walsh_hadamard_matrix(size_t N) {
+  Matrix<double> H1 = walsh_hadamard_factor();
+  Matrix<double> Hn = H1;
 
-  for(size_t i=0; i<log2(N)-1; i++) {
-    Hptr = &mat_vector.back();
-    mat_vector.push_back(kronecker<double>(H1, *Hptr) );
+  for(size_t n=2; n<N; n*=2) {
+    Hn = kronecker<double>(H1, Hn);
   }
 
-  return mat_vector.back();
+  return Hn;
+}
+
+// H1 x H1 x ... x H1 (log2(N) factors), applied without building the matrix
+inline KroneckerOperator<double> walsh_hadamard_operator(size_t N) {
+  Matrix<double> H1 = walsh_hadamard_factor();
+  KroneckerOperator<double> Hn;
+
+  for(size_t n=1; n<N; n*=2) {
+    Hn.push_back(H1);
+  }
+
+  return Hn;
+}
+
+// Normalization of the fast Walsh-Hadamard transform:
+//   none:        H x, with H made of +1/-1
+//   orthonormal: H x / sqrt(N) (the transform is its own inverse)
+//   custom:      H x * scale
+enum class WhtNorm { none, orthonormal, custom };
+
+// Blocks of WHT_BLOCK elements are completed in cache before the larger stages
+constexpr size_t WHT_BLOCK = 1 << 12;
+
+// Below this size the transform runs on one thread
+constexpr size_t WHT_MIN_PARALLEL = 1 << 16;
+
+// 2, 4 and 8-point transforms on registers
+template <typename T>
+inline void wht2(T& x0, T& x1) {
+  T s = x0 + x1;
+  T d = x0 - x1;
+  x0 = s;
+  x1 = d;
+}
+
+template <typename T>
+inline void wht4(T* x) {
+  wht2(x[0], x[1]); wht2(x[2], x[3]);
+  wht2(x[0], x[2]); wht2(x[1], x[3]);
 }
 
 template <typename T>
-void fast_walsh_hadamard(std::vector<T>& a) {
-  size_t N = a.size();
-  for(size_t h=1; h<N; h*=2) {
-    for(size_t i=0; i<N; i+=2*h) {
-      for(size_t j=i; j<i+h; j++) {
-         T x = a[j];
-         T y = a[j + h];
-         a[j] = x + y;
-         a[j + h] = x - y;
-      }
+inline void wht8(T* x) {
+  wht2(x[0], x[1]); wht2(x[2], x[3]); wht2(x[4], x[5]); wht2(x[6], x[7]);
+  wht2(x[0], x[2]); wht2(x[1], x[3]); wht2(x[4], x[6]); wht2(x[5], x[7]);
+  wht2(x[0], x[4]); wht2(x[1], x[5]); wht2(x[2], x[6]); wht2(x[3], x[7]);
+}
+
+// One radix-R pass, i.e. log2(R) fused stages starting from half-span h.
+// The N/R butterflies are numbered u = g*h + j (group g, offset j): this
+// processes u in [begin, end), as runs of consecutive j that the compiler can vectorize.
+template <typename T, size_t R>
+void wht_pass(T* a, size_t h, size_t begin, size_t end, T s) {
+  if(h == 1) {
+    // First stages: R contiguous elements per butterfly
+    for(size_t u=begin; u<end; u++) {
+      T* x = a + u*R;
+      if constexpr (R == 8) wht8(x);
+      else if constexpr (R == 4) wht4(x);
+      else wht2(x[0], x[1]);
+      for(size_t i=0; i<R; i++)
+        x[i] *= s;
     }
-    for(size_t i=0; i<N; i++) {
-      a[i] *= INVSQRT2;
+    return;
+  }
+
+  size_t u = begin;
+  while(u < end) {
+    size_t g = u / h;
+    size_t j = u % h;
+    size_t run = std::min(h - j, end - u);
+    T* base = a + g*R*h + j;
+
+    for(size_t k=0; k<run; k++) {
+      T x[R];
+      for(size_t i=0; i<R; i++)
+        x[i] = base[k + i*h];
+
+      if constexpr (R == 8) wht8(x);
+      else if constexpr (R == 4) wht4(x);
+      else wht2(x[0], x[1]);
+
+      for(size_t i=0; i<R; i++)
+        base[k + i*h] = x[i] * s;
     }
+    u += run;
+  }
+}
+
+// Radix of the pass starting at half-span h in a transform of size N
+inline size_t wht_radix(size_t h, size_t N) {
+  if(8*h <= N) return 8;
+  if(4*h <= N) return 4;
+  return 2;
+}
+
+template <typename T>
+void wht_pass(T* a, size_t R, size_t h, size_t begin, size_t end, T s) {
+  if(R == 8) wht_pass<T, 8>(a, h, begin, end, s);
+  else if(R == 4) wht_pass<T, 4>(a, h, begin, end, s);
+  else wht_pass<T, 2>(a, h, begin, end, s);
+}
+
+// All the stages of a transform of size N (N <= WHT_BLOCK) on one thread
+template <typename T>
+void wht_block(T* a, size_t N, T s) {
+  for(size_t h=1; h<N; ) {
+    size_t R = wht_radix(h, N);
+    wht_pass(a, R, h, 0, N / R, (h * R == N) ? s : T(1));
+    h *= R;
+  }
+  if(N == 1)
+    a[0] *= s;
+}
+
+template <typename T>
+T wht_scale(size_t N, WhtNorm norm, T scale) {
+  switch(norm) {
+    case WhtNorm::orthonormal:
+      return T(1 / sqrt((double)N));
+    case WhtNorm::custom:
+      return scale;
+    default:
+      return T(1);
+  }
+}
+
+// In-place fast Walsh-Hadamard transform of a[0..N), N power of 2.
+// The normalization is applied once, in the last pass.
+template <typename T>
+void fast_walsh_hadamard(T* a, size_t N, WhtNorm norm = WhtNorm::orthonormal, T scale = 1, size_t threads = 0) {
+  if(N < 2) {
+    if(N == 1)
+      a[0] *= wht_scale<T>(N, norm, scale);
+    return;
+  }
+  T s = wht_scale<T>(N, norm, scale);
+  size_t T_num = (N < WHT_MIN_PARALLEL) ? 1 : num_threads(threads);
+
+  // Stages with span < WHT_BLOCK: each block is completed while in cache
+  size_t B = std::min(N, WHT_BLOCK);
+  T s_block = (B == N) ? s : T(1);
+  parallel_for(N / B, [&](size_t begin, size_t end) {
+    for(size_t b=begin; b<end; b++)
+      wht_block(a + b*B, B, s_block);
+  }, T_num);
+
+  // Larger stages: up to 3 fused stages per sweep of the array
+  for(size_t h=B; h<N; ) {
+    size_t R = wht_radix(h, N);
+    T s_pass = (h * R == N) ? s : T(1);
+    parallel_for(N / R, [&](size_t begin, size_t end) {
+      wht_pass(a, R, h, begin, end, s_pass);
+    }, T_num);
+    h *= R;
   }
 }
+
+template <typename T>
+void fast_walsh_hadamard(std::vector<T>& a, WhtNorm norm = WhtNorm::orthonormal, T scale = 1, size_t threads = 0) {
+  fast_walsh_hadamard(a.data(), a.size(), norm, scale, threads);
+}
+
+// Transform count vectors of N elements, the i-th one starting at a + i*dist.
+// Vectors are spread over the threads; a single large vector uses them internally.
+template <typename T>
+void fast_walsh_hadamard_batch(T* a, size_t N, size_t count, size_t dist, WhtNorm norm = WhtNorm::orthonormal, T scale = 1, size_t threads = 0) {
+  size_t T_num = num_threads(threads);
+  if(count >= T_num || N * count < WHT_MIN_PARALLEL) {
+    if(N * count < WHT_MIN_PARALLEL)
+      T_num = 1;
+    parallel_for(count, [&](size_t begin, size_t end) {
+      for(size_t i=begin; i<end; i++)
+        fast_walsh_hadamard(a + i*dist, N, norm, scale, 1);
+    }, T_num);
+  }
+  else {
+    for(size_t i=0; i<count; i++)
+      fast_walsh_hadamard(a + i*dist, N, norm, scale, T_num);
+  }
+}
+
+// In-place 2D Walsh-Hadamard transform, rows and cols must be powers of 2
+template <typename T>
+void fast_walsh_hadamard_2D(T* data, size_t rows, size_t cols, size_t stride, size_t threads = 0) {
+  auto op = [](T* line, size_t n, T*) {
+    fast_walsh_hadamard(line, n, WhtNorm::orthonormal, T(1), 1);
+  };
+  separable_2d(data, rows, cols, stride, op, threads);
+}
+
+template <typename T>
+void fast_walsh_hadamard_2D(MatrixView<T> v, size_t threads = 0) {
+  auto op = [](T* line, size_t n, T*) {
+    fast_walsh_hadamard(line, n, WhtNorm::orthonormal, T(1), 1);
+  };
+  separable_2d(v, op, threads);
+}
@@ -0,0 +1,90 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// Byte counts in four tables, one for each byte of a 4-byte word. In a
+// run of the same byte the increments go to different counters, so an
+// increment does not wait for the previous store to the same counter.
+// The tables are 32-bit, the data is counted in pieces of at most 2^32
+// bytes so that they do not overflow.
+inline void byte_histogram(const uint8_t* data, size_t size, uint64_t* freq) {
+  std::fill(freq, freq + 256, 0);
+  const size_t piece = (size_t)1 << 32;
+  for(size_t start=0; start<size; start+=piece) {
+    size_t n = std::min(piece, size - start);
+    const uint8_t* p = data + start;
+    uint32_t sub[4][256] = {};
+    size_t i = 0;
+    for(; i+4<=n; i+=4) {
+      sub[0][p[i]]++;
+      sub[1][p[i + 1]]++;
+      sub[2][p[i + 2]]++;
+      sub[3][p[i + 3]]++;
+    }
+    for(; i<n; i++)
+      sub[0][p[i]]++;
+    for(size_t s=0; s<256; s++)
+      freq[s] += (uint64_t)sub[0][s] + sub[1][s] + sub[2][s] + sub[3][s];
+  }
+}
+
+inline std::vector<uint64_t> byte_histogram(const uint8_t* data, size_t size) {
+  std::vector<uint64_t> freq(256);
+  byte_histogram(data, size, freq.data());
+  return freq;
+}
+
+// Frequencies scaled to sum to 2^scale_bits, keeping at least 1 for the
+// used symbols. The rounding errors are taken from, or given to, the
+// symbols with the largest scaled frequencies, where they change the code
+// lengths the least.
+inline void normalize_frequencies(const uint64_t* freq, size_t n, size_t scale_bits, uint32_t* scaled) {
+  uint64_t total = 0;
+  size_t used = 0;
+  for(size_t s=0; s<n; s++) {
+    total += freq[s];
+    used += (freq[s] > 0);
+  }
+  const uint64_t M = (uint64_t)1 << scale_bits;
+  if(used > M) {
+    std::cout << used << " symbols do not fit in frequencies of " << scale_bits << " bits." << std::endl;
+    exit(1);
+  }
+  std::fill(scaled, scaled + n, 0);
+  if(total == 0)
+    return;
+
+  int64_t sum = 0;
+  size_t largest = 0;
+  for(size_t s=0; s<n; s++) {
+    if(freq[s] > 0)
+      scaled[s] = std::max<uint64_t>(1, (uint64_t)((double)freq[s] * M / total + 0.5));
+    sum += scaled[s];
+    if(scaled[s] > scaled[largest])
+      largest = s;
+  }
+  if(sum < (int64_t)M) {
+    scaled[largest] += M - sum;
+    return;
+  }
+  // Too many: one less for the largest ones in turn. As there are at
+  // most M used symbols, one of them is above 1.
+  while(sum > (int64_t)M) {
+    for(size_t s=0; s<n && sum>(int64_t)M; s++) {
+      if(scaled[s] > 1 && scaled[s] * 2 >= scaled[largest]) {
+        scaled[s]--;
+        sum--;
+      }
+    }
+    for(size_t s=0; s<n; s++)
+      if(scaled[s] > scaled[largest])
+        largest = s;
+  }
+}
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef HUFFMAN_H
+#define HUFFMAN_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "histogram.hpp"
+
+// Canonical Huffman coding. A code is described by the length of the code
+// of each symbol only (0 for unused symbols): the codes themselves follow
+// from the lengths (shorter codes first, then by symbol), so a header only
+// stores the lengths.
+//
+// Bits are written and read least significant first through a 64-bit
+// buffer, so codes are stored bit-reversed. The decoder looks up the next
+// HUFFMAN_TABLE_BITS bits in a table that gives the symbol and the length
+// of its code. Longer codes point to a second-level table indexed by the
+// bits that follow.
+
+// Longest code, and bits of the first decoding table
+constexpr size_t HUFFMAN_MAX_BITS = 15;
+constexpr size_t HUFFMAN_TABLE_BITS = 11;
+
+// Lengths of Huffman codes, built in arrays that are kept from one call to
+// the next so that a code can be rebuilt for each block of data without
+// allocating. Nodes are indices into these arrays.
+//
+// The used symbols are sorted by frequency, and the tree is built in O(n)
+// with two queues: the sorted leaves, and the internal nodes, which are made
+// in increasing weight. If the tree is deeper than max_bits, the lengths come
+// from package-merge instead, which gives the best code whose lengths are at
+// most max_bits, in O(n max_bits).
+struct HuffmanBuilder {
+  // Methods
+  // Lengths of the codes of n symbols of the given frequencies, 0 for the
+  // unused symbols
+  void build(const uint64_t* freq, size_t n, size_t max_bits, uint8_t* lengths) {
+    std::fill(lengths, lengths + n, 0);
+    symbols.clear();
+    for(size_t s=0; s<n; s++)
+      if(freq[s] > 0)
+        symbols.push_back(s);
+    size_t m = symbols.size();
+    if(m == 0)
+      return;
+    if(m == 1) {
+      lengths[symbols[0]] = 1;
+      return;
+    }
+    if(max_bits >= 64 || m > ((size_t)1 << max_bits)) {
+      std::cout << m << " symbols do not fit in codes of " << max_bits << " bits." << std::endl;
+      exit(1);
+    }
+
+    // Leaves by increasing frequency, ties by symbol
+    std::sort(symbols.begin(), symbols.end(), [&](uint32_t a, uint32_t b) {
+      return (freq[a] != freq[b]) ? freq[a] < freq[b] : a < b;
+    });
+    weight.resize(2*m - 1);
+    for(size_t i=0; i<m; i++)
+      weight[i] = freq[symbols[i]];
+
+    if(two_queue(m) > max_bits)
+      package_merge(m, max_bits);
+    for(size_t i=0; i<m; i++)
+      lengths[symbols[i]] = depth[i];
+  }
+
+  // Attributes
+  private:
+    // Tree of the m sorted leaves, then the depth of each node. Returns the
+    // depth of the deepest leaf.
+    size_t two_queue(size_t m) {
+      parent.resize(2*m - 1);
+      depth.resize(2*m - 1);
+      // Next leaf and next internal node not yet merged
+      size_t leaf = 0;
+      size_t inner = m;
+      for(size_t node=m; node<2*m-1; node++) {
+        uint64_t sum = 0;
+        for(size_t k=0; k<2; k++) {
+          size_t i = (leaf < m && (inner == node || weight[leaf] <= weight[inner])) ? leaf++ : inner++;
+          parent[i] = node;
+          sum += weight[i];
+        }
+        weight[node] = sum;
+      }
+
+      // Parents come after their children
+      depth[2*m - 2] = 0;
+      size_t longest = 0;
+      for(size_t i=2*m-2; i-->0;) {
+        depth[i] = depth[parent[i]] + 1;
+        longest = std::max<size_t>(longest, depth[i]);
+      }
+      return longest;
+    }
+
+    // Lengths of at most L bits of the m sorted leaves. The list of level L
+    // is the leaves; the list of each level above merges the leaves with
+    // the pairs (packages) of the list below. The 2m - 2 first items of the
+    // top list are kept, and a leaf is one bit longer for each level where
+    // it is among the kept items, found back from the top down.
+    void package_merge(size_t m, size_t L) {
+      size_t width = 2*m;
+      is_leaf.assign(L * width, 0);
+      list.resize(width);
+      merged.resize(width);
+      std::copy(weight.begin(), weight.begin() + m, list.begin());
+      std::fill(is_leaf.begin() + (L - 1) * width, is_leaf.begin() + (L - 1) * width + m, 1);
+      size_t length = m;
+      for(size_t j=L-1; j-->0;) {
+        uint8_t* leaf_flag = is_leaf.data() + j * width;
+        size_t packages = length / 2;
+        size_t a = 0;
+        size_t b = 0;
+        size_t k = 0;
+        for(; a<m || b<packages; k++) {
+          if(b == packages || (a < m && weight[a] <= list[2*b] + list[2*b + 1])) {
+            merged[k] = weight[a++];
+            leaf_flag[k] = 1;
+          }
+          else {
+            merged[k] = list[2*b] + list[2*b + 1];
+            b++;
+          }
+        }
+        length = k;
+        std::swap(list, merged);
+      }
+
+      std::fill(depth.begin(), depth.begin() + m, 0);
+      size_t kept = 2*m - 2;
+      for(size_t j=0; j<L && kept>0; j++) {
+        const uint8_t* leaf_flag = is_leaf.data() + j * width;
+        // The leaves among the kept items are the first ones
+        size_t leaves = 0;
+        for(size_t k=0; k<kept; k++)
+          leaves += leaf_flag[k];
+        for(size_t i=0; i<leaves; i++)
+          depth[i]++;
+        kept = 2 * (kept - leaves);
+      }
+    }
+
+    std::vector<uint32_t> symbols;
+    std::vector<uint64_t> weight;
+    std::vector<uint32_t> parent;
+    std::vector<uint8_t> depth;
+    std::vector<uint64_t> list;
+    std::vector<uint64_t> merged;
+    std::vector<uint8_t> is_leaf;
+};
+
+// Lengths of the codes of n symbols of the given frequencies, at most
+// max_bits
+inline std::vector<uint8_t> huffman_code_lengths(const uint64_t* freq, size_t n, size_t max_bits = HUFFMAN_MAX_BITS) {
+  std::vector<uint8_t> lengths(n);
+  HuffmanBuilder builder;
+  builder.build(freq, n, max_bits, lengths.data());
+  return lengths;
+}
+
+inline uint32_t reverse_bits(uint32_t code, size_t length) {
+  uint32_t r = 0;
+  for(size_t i=0; i<length; i++) {
+    r = (r << 1) | (code & 1);
+    code >>= 1;
+  }
+  return r;
+}
+
+// Canonical codes of the given lengths, bit-reversed for LSB-first writing
+inline std::vector<uint32_t> canonical_codes(const std::vector<uint8_t>& lengths) {
+  std::vector<uint32_t> count(HUFFMAN_MAX_BITS + 1, 0);
+  for(uint8_t l : lengths) {
+    if(l > HUFFMAN_MAX_BITS) {
+      std::cout << "Huffman codes are limited to " << HUFFMAN_MAX_BITS << " bits." << std::endl;
+      exit(1);
+    }
+    count[l]++;
+  }
+  count[0] = 0;
+
+  // First code of each length
+  std::vector<uint32_t> next(HUFFMAN_MAX_BITS + 2, 0);
+  uint32_t code = 0;
+  for(size_t l=1; l<=HUFFMAN_MAX_BITS; l++) {
+    code = (code + count[l - 1]) << 1;
+    next[l] = code;
+  }
+  // The lengths must not overflow the code space (Kraft inequality)
+  if(next[HUFFMAN_MAX_BITS] + count[HUFFMAN_MAX_BITS] > ((uint32_t)1 << HUFFMAN_MAX_BITS)) {
+    std::cout << "The Huffman code lengths are not valid." << std::endl;
+    exit(1);
+  }
+
+  std::vector<uint32_t> codes(lengths.size(), 0);
+  for(size_t s=0; s<lengths.size(); s++)
+    if(lengths[s] > 0)
+      codes[s] = reverse_bits(next[lengths[s]]++, lengths[s]);
+  return codes;
+}
+
+// 8 bytes in little-endian order
+inline uint64_t load_le64(const uint8_t* p) {
+  uint64_t v;
+  if constexpr(std::endian::native == std::endian::little) {
+    memcpy(&v, p, 8);
+  }
+  else {
+    v = 0;
+    for(size_t i=0; i<8; i++)
+      v |= (uint64_t)p[i] << (8*i);
+  }
+  return v;
+}
+
+inline void store_le64(uint8_t* p, uint64_t v) {
+  if constexpr(std::endian::native == std::endian::little) {
+    memcpy(p, &v, 8);
+  }
+  else {
+    for(size_t i=0; i<8; i++)
+      p[i] = v >> (8*i);
+  }
+}
+
+inline uint32_t load_le32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline void store_le32(uint8_t* p, uint32_t v) {
+  for(size_t i=0; i<4; i++)
+    p[i] = v >> (8*i);
+}
+
+// Bits packed least significant first. The buffer holds up to 64 bits and
+// is emptied 8 bytes at a time.
+struct BitWriter {
+  // Constructor
+  // Room for about capacity bytes, to avoid growing the output
+  BitWriter(size_t capacity = 0)
+  : out(capacity + 8) {}
+
+  // Methods
+  // Write the n low bits of bits (n <= 32). The buffer is emptied before it
+  // is full, as a shift by the 64 bits of a full buffer is undefined.
+  void put(uint64_t bits, size_t n) {
+    if(count + n >= 64)
+      flush();
+    put_unchecked(bits, n);
+  }
+
+  // Same, when the caller knows that the buffer has room for n bits
+  // (at most 57 bits after flush())
+  void put_unchecked(uint64_t bits, size_t n) {
+    buf |= bits << count;
+    count += n;
+  }
+
+  // Store the whole buffer, keep the bits of the last partial byte
+  void flush() {
+    if(pos + 8 > out.size())
+      out.resize(2 * out.size());
+    store_le64(out.data() + pos, buf);
+    size_t bytes = count / 8;
+    pos += bytes;
+    buf = (bytes == 8) ? 0 : buf >> (8*bytes);
+    count -= 8*bytes;
+  }
+
+  // Number of bits written so far
+  size_t size_bits() const {
+    return 8 * pos + count;
+  }
+
+  // The bytes, the last one padded with zeros
+  std::vector<uint8_t> finish() {
+    flush();
+    if(count > 0)
+      out.resize(pos + 1);
+    else
+      out.resize(pos);
+    return std::move(out);
+  }
+
+  // Attributes
+  private:
+    std::vector<uint8_t> out;
+    size_t pos = 0;
+    uint64_t buf = 0;
+    size_t count = 0;
+};
+
+// Bits read least significant first. refill() loads whole bytes until the
+// buffer holds at least 56 bits; zeros are read past the end.
+struct BitReader {
+  // Constructor
+  BitReader(const uint8_t* data, size_t size)
+  : data { data }, size { size } {}
+
+  // Methods
+  void refill() {
+    if(pos + 8 <= size) {
+      buf |= load_le64(data + pos) << count;
+      pos += (63 - count) / 8;
+      count |= 56;
+    }
+    else {
+      while(count <= 56) {
+        if(pos < size)
+          buf |= (uint64_t)data[pos] << count;
+        pos++;
+        count += 8;
+      }
+    }
+  }
+
+  uint64_t peek() const {
+    return buf;
+  }
+
+  void consume(size_t n) {
+    buf >>= n;
+    count -= n;
+  }
+
+  // The next n bits (n <= 56)
+  uint64_t get(size_t n) {
+    if(count < n)
+      refill();
+    uint64_t v = buf & (((uint64_t)1 << n) - 1);
+    consume(n);
+    return v;
+  }
+
+  // Bits read past the end of the data
+  bool overrun() const {
+    return 8 * pos > 8 * size + count;
+  }
+
+  // Attributes
+  private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t buf = 0;
+    size_t count = 0;
+};
+
+// Table-driven decoder of a canonical code. An entry holds the symbol in
+// its high 16 bits and the code length in its low 8 bits; in the first
+// table, an entry with a length of 0 and a non-zero bits field points to a
+// second-level table at offset symbol, indexed by bits more bits.
+struct HuffmanDecoder {
+  // Constructor
+  HuffmanDecoder() = default;
+
+  HuffmanDecoder(const std::vector<uint8_t>& lengths) {
+    std::vector<uint32_t> codes = canonical_codes(lengths);
+    const size_t B = HUFFMAN_TABLE_BITS;
+    table.assign((size_t)1 << B, 0);
+
+    // Longest code behind each first-table entry
+    std::vector<uint8_t> longest((size_t)1 << B, 0);
+    for(size_t s=0; s<lengths.size(); s++) {
+      max_length = std::max<size_t>(max_length, lengths[s]);
+      if(lengths[s] > B) {
+        uint32_t prefix = codes[s] & ((1 << B) - 1);
+        longest[prefix] = std::max(longest[prefix], lengths[s]);
+      }
+    }
+    for(size_t p=0; p<longest.size(); p++) {
+      if(longest[p] > 0) {
+        size_t bits = longest[p] - B;
+        table[p] = entry(table.size(), 0, bits);
+        table.resize(table.size() + ((size_t)1 << bits), 0);
+      }
+    }
+
+    for(size_t s=0; s<lengths.size(); s++) {
+      size_t l = lengths[s];
+      if(l == 0)
+        continue;
+      if(l <= B) {
+        // All the entries starting with the code
+        for(size_t i=codes[s]; i<((size_t)1 << B); i+=((size_t)1 << l))
+          table[i] = entry(s, l, 0);
+      }
+      else {
+        uint32_t e = table[codes[s] & ((1 << B) - 1)];
+        size_t offset = e >> 16;
+        size_t bits = (e >> 8) & 0xFF;
+        for(size_t i=codes[s] >> B; i<((size_t)1 << bits); i+=((size_t)1 << (l - B)))
+          table[offset + i] = entry(s, l, 0);
+      }
+    }
+  }
+
+  // Methods
+  // The buffer of reader must hold at least max_length bits
+  uint32_t decode(BitReader& reader) const {
+    uint64_t bits = reader.peek();
+    uint32_t e = table[bits & ((1 << HUFFMAN_TABLE_BITS) - 1)];
+    if((e & 0xFF) == 0) {
+      size_t sub = (e >> 8) & 0xFF;
+      if(sub == 0) {
+        std::cout << "Invalid Huffman code in the data." << std::endl;
+        exit(1);
+      }
+      e = table[(e >> 16) + ((bits >> HUFFMAN_TABLE_BITS) & ((1 << sub) - 1))];
+      if((e & 0xFF) == 0) {
+        std::cout << "Invalid Huffman code in the data." << std::endl;
+        exit(1);
+      }
+    }
+    reader.consume(e & 0xFF);
+    return e >> 16;
+  }
+
+  size_t get_max_length() const {
+    return max_length;
+  }
+
+  // Attributes
+  private:
+    static uint32_t entry(size_t symbol, size_t length, size_t bits) {
+      return (uint32_t)symbol << 16 | (uint32_t)bits << 8 | (uint32_t)length;
+    }
+
+    std::vector<uint32_t> table;
+    size_t max_length = 0;
+};
+
+// The code lengths of 256 byte values on 4 bits each
+inline void huffman_write_lengths(BitWriter& writer, const uint8_t* lengths) {
+  for(size_t s=0; s<256; s++)
+    writer.put(lengths[s], 4);
+}
+
+inline void huffman_read_lengths(BitReader& reader, uint8_t* lengths) {
+  for(size_t s=0; s<256; s++)
+    lengths[s] = reader.get(4);
+}
+
+// Codes of size bytes
+inline void huffman_encode(const uint8_t* data, size_t size, const uint8_t* lengths, const uint32_t* codes, BitWriter& writer) {
+  // Three codes of up to 15 bits between flushes
+  size_t i = 0;
+  for(; i+3<=size; i+=3) {
+    writer.flush();
+    writer.put_unchecked(codes[data[i]], lengths[data[i]]);
+    writer.put_unchecked(codes[data[i + 1]], lengths[data[i + 1]]);
+    writer.put_unchecked(codes[data[i + 2]], lengths[data[i + 2]]);
+  }
+  for(; i<size; i++)
+    writer.put(codes[data[i]], lengths[data[i]]);
+}
+
+// n bytes, exits if the data ends before
+inline void huffman_decode(BitReader& reader, const HuffmanDecoder& decoder, uint8_t* out, size_t n) {
+  if(n > 0 && decoder.get_max_length() == 0) {
+    std::cout << "The Huffman data has no code." << std::endl;
+    exit(1);
+  }
+
+  // A refill leaves at least 56 bits: three codes of 15 bits
+  size_t i = 0;
+  for(; i+3<=n; i+=3) {
+    reader.refill();
+    out[i]     = decoder.decode(reader);
+    out[i + 1] = decoder.decode(reader);
+    out[i + 2] = decoder.decode(reader);
+  }
+  for(; i<n; i++) {
+    reader.refill();
+    out[i] = decoder.decode(reader);
+  }
+  if(reader.overrun()) {
+    std::cout << "The Huffman data is truncated." << std::endl;
+    exit(1);
+  }
+}
+
+// Compressed bytes: the input size on 8 bytes, the 256 code lengths on
+// 4 bits each, then the codes
+inline std::vector<uint8_t> huffman_compress(const uint8_t* data, size_t size) {
+  std::vector<uint64_t> freq = byte_histogram(data, size);
+  std::vector<uint8_t> lengths = huffman_code_lengths(freq.data(), 256);
+  std::vector<uint32_t> codes = canonical_codes(lengths);
+
+  // Room for the header and codes of up to 8 bits on average
+  BitWriter writer(size + 256);
+  writer.put(size & 0xFFFFFFFF, 32);
+  writer.put(size >> 32, 32);
+  huffman_write_lengths(writer, lengths.data());
+  huffman_encode(data, size, lengths.data(), codes.data(), writer);
+  return writer.finish();
+}
+
+inline std::vector<uint8_t> huffman_decompress(const uint8_t* data, size_t size) {
+  BitReader reader(data, size);
+  uint64_t n = reader.get(32);
+  n |= reader.get(32) << 32;
+  std::vector<uint8_t> lengths(256);
+  huffman_read_lengths(reader, lengths.data());
+  HuffmanDecoder decoder(lengths);
+
+  std::vector<uint8_t> out(n);
+  huffman_decode(reader, decoder, out.data(), n);
+  return out;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef KRONECKER_H
+#define KRONECKER_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "matrix.hpp"
+
+// Lazy Kronecker product A_0 x A_1 x ... x A_{k-1}.
+// Only the factors are stored. The product is applied to a vector one factor
+// at a time, seeing x as a tensor of dimensions (c_0, ..., c_{k-1}):
+// factor i maps dimension i from c_i to r_i. Memory is O(size of x), time is
+// O(size of x * sum(r_i)), instead of O(R * C) for the materialized product.
+template <typename T>
+struct KroneckerOperator {
+  // Constructors
+  KroneckerOperator() = default;
+
+  KroneckerOperator(ConstMatrixView<T> A) {
+    push_back(A);
+  }
+
+  KroneckerOperator(const Matrix<T>& A) {
+    push_back(A.view());
+  }
+
+  KroneckerOperator(const std::vector<Matrix<T>>& factors) {
+    for(const auto& A : factors)
+      push_back(A.view());
+  }
+
+  // Methods
+
+  // this = this x A
+  KroneckerOperator& push_back(ConstMatrixView<T> A) {
+    Factor f;
+    f.rows = A.r();
+    f.cols = A.c();
+    f.buf.resize(f.rows * f.cols);
+    for(size_t r=0; r<f.rows; r++) {
+      for(size_t c=0; c<f.cols; c++) {
+        f.buf[r*f.cols + c] = A(r, c);
+      }
+    }
+    factors.push_back(f);
+    return *this;
+  }
+
+  KroneckerOperator& push_back(const Matrix<T>& A) {
+    return push_back(A.view());
+  }
+
+  size_t r() const {
+    size_t res = 1;
+    for(const auto& f : factors)
+      res *= f.rows;
+    return res;
+  }
+
+  size_t c() const {
+    size_t res = 1;
+    for(const auto& f : factors)
+      res *= f.cols;
+    return res;
+  }
+
+  size_t num_factors() const {
+    return factors.size();
+  }
+
+  // y = (A_0 x ... x A_{k-1}) x, for count vectors stored one after the other:
+  // x holds count * c() elements, y holds count * r() elements. The
+  // workspace is allocated per call, so that threads can share the operator.
+  void apply(const T* x, T* y, size_t count = 1) const {
+    size_t C = c();
+    if(factors.empty()) {
+      std::copy(x, x + count*C, y);
+      return;
+    }
+
+    // Largest intermediate size
+    size_t size = C;
+    size_t max_size = C;
+    for(const auto& f : factors) {
+      size = size / f.cols * f.rows;
+      max_size = std::max(max_size, size);
+    }
+    std::vector<T> work(2 * count * max_size);
+    T* ping = work.data();
+    T* pong = work.data() + count * max_size;
+
+    // Dimensions before the current factor (already mapped to rows) and after it
+    size_t left = count;
+    size_t right = C;
+    const T* src = x;
+    for(size_t i=0; i<factors.size(); i++) {
+      const Factor& f = factors[i];
+      right /= f.cols;
+      T* dst = (i == factors.size() - 1) ? y : ((i % 2 == 0) ? ping : pong);
+
+      for(size_t l=0; l<left; l++) {
+        const T* in = src + l * f.cols * right;
+        T* out = dst + l * f.rows * right;
+        for(size_t p=0; p<f.rows; p++) {
+          T* out_p = out + p * right;
+          std::fill(out_p, out_p + right, T(0));
+          for(size_t q=0; q<f.cols; q++) {
+            T a = f.buf[p*f.cols + q];
+            const T* in_q = in + q * right;
+            for(size_t k=0; k<right; k++)
+              out_p[k] += a * in_q[k];
+          }
+        }
+      }
+
+      left *= f.rows;
+      src = dst;
+    }
+  }
+
+  // Operators
+  std::vector<T> operator * (const std::vector<T>& x) const {
+    if(x.size() != c()) {
+      std::cout << "Cannot multiply a " << r() << "x" << c() << " Kronecker operator by a vector of size " << x.size() << "." << std::endl;
+      exit(1);
+    }
+    std::vector<T> y(r());
+    apply(x.data(), y.data());
+    return y;
+  }
+
+  // Materialized product, for small sizes and tests
+  Matrix<T> dense() const {
+    size_t R = r();
+    size_t C = c();
+    Matrix<T> res(R, C);
+    std::vector<T> e(C);
+    std::vector<T> col(R);
+    for(size_t c=0; c<C; c++) {
+      std::fill(e.begin(), e.end(), T(0));
+      e[c] = 1;
+      apply(e.data(), col.data());
+      for(size_t r=0; r<R; r++)
+        res.set(r, c, col[r]);
+    }
+    return res;
+  }
+
+  // Attributes
+  private:
+    struct Factor {
+      size_t rows;
+      size_t cols;
+      std::vector<T> buf; // row-major
+    };
+    std::vector<Factor> factors;
+};
+
+template <typename T>
+KroneckerOperator<T> kronecker(const KroneckerOperator<T>& A, const Matrix<T>& B) {
+  KroneckerOperator<T> res = A;
+  res.push_back(B);
+  return res;
+}
+
+#endif
@@ -1,9 +1,43 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
 #include <cstdio>
 #include <cstring>
 #include <stdexcept>
+#include <iostream>
+#include <vector>
+#include <type_traits>
+
+#include "gemm.hpp"
+
+// Elementwise expressions (sums, differences, scaling) are not computed when
+// written, but when assigned to a Matrix: the whole chain is then evaluated in
+// one loop, without temporaries (except for expressions that read through
+// views, which can overlap the assigned elements). Every expression E
+// provides r(), c() and at(i), the i-th element in row-major order.
+// Expressions keep references to their Matrix operands: assign them to a
+// Matrix, do not store them with auto.
+template <typename E>
+struct MatExpr {
+  const E& self() const {
+    return static_cast<const E&>(*this);
+  }
+};
+
+template <typename T> struct MatrixView;
+template <typename T> struct ConstMatrixView;
+
+// Whether an expression reads through a view: element i then comes from
+// anywhere in the viewed buffer, not only from element i of its operands
+template <typename E>
+struct MatStrided {
+  static constexpr bool value = false;
+};
 
 template <typename T>
-struct Matrix {
+struct Matrix : MatExpr<Matrix<T>> {
+  using value_type = T;
+
   // Constructor
   Matrix(size_t rows, size_t cols)
   : rows { rows } , cols { cols } {
@@ -11,6 +45,14 @@ struct Matrix {
     buf[0] = 0;
   }
 
+  // Evaluate an expression
+  template <typename E>
+  Matrix(const MatExpr<E>& e)
+  : rows { e.self().r() } , cols { e.self().c() } {
+    buf = new T[rows*cols];
+    assign(e.self());
+  }
+
   // Destructor
   ~Matrix() {
     if(buf != nullptr)
@@ -49,6 +91,19 @@ struct Matrix {
     other.cols = 0;
   }
 
+  // A view can read this matrix in another order, and a new size frees the
+  // buffer that e may reference: evaluate into a new buffer in both cases
+  template <typename E>
+  Matrix& operator=(const MatExpr<E>& e) {
+    const E& x = e.self();
+    if(MatStrided<E>::value || x.r() * x.c() != rows * cols)
+      return *this = Matrix(e);
+    rows = x.r();
+    cols = x.c();
+    assign(x);
+    return *this;
+  }
+
   // Methods
   void print() {
     for(size_t r=0; r<rows; r++) {
@@ -60,11 +115,11 @@ struct Matrix {
     }
   }
 
-  T r() {
+  size_t r() const {
     return this->rows;
   }
 
-  T c() {
+  size_t c() const {
     return this->cols;
   }
 
@@ -80,81 +135,426 @@ struct Matrix {
     return buf[r*cols + c];
   }
 
+  // Unchecked access
+  T& operator()(const size_t r, const size_t c) {
+    return buf[r*cols + c];
+  }
+
+  const T& operator()(const size_t r, const size_t c) const {
+    return buf[r*cols + c];
+  }
+
+  T at(const size_t i) const {
+    return buf[i];
+  }
+
+  T* data() {
+    return buf;
+  }
+
+  const T* data() const {
+    return buf;
+  }
+
+  MatrixView<T> view();
+  ConstMatrixView<T> view() const;
+
   // Operators
   Matrix& operator=(Matrix&& other) noexcept {
     if(this == &other) return *this;
     delete[] buf;
     rows = other.rows;
     cols = other.cols;
-    buf = new T[rows*cols];
-    memcpy(buf, other.buf, rows*cols*sizeof(T));	
+    buf = other.buf;
+
+    other.buf = nullptr;
+    other.rows = 0;
+    other.cols = 0;
+    return *this;
+  }
+
+  template <typename E>
+  Matrix& operator+=(const MatExpr<E>& e) {
+    if constexpr(MatStrided<E>::value)
+      return *this += Matrix(e);
+    const E& x = e.self();
+    check_size(x.r(), x.c());
+    for(size_t i=0; i<rows*cols; i++)
+      buf[i] += x.at(i);
+    return *this;
+  }
+
+  template <typename E>
+  Matrix& operator-=(const MatExpr<E>& e) {
+    if constexpr(MatStrided<E>::value)
+      return *this -= Matrix(e);
+    const E& x = e.self();
+    check_size(x.r(), x.c());
+    for(size_t i=0; i<rows*cols; i++)
+      buf[i] -= x.at(i);
+    return *this;
+  }
+
+  Matrix& operator*=(const T& a) {
+    for(size_t i=0; i<rows*cols; i++)
+      buf[i] *= a;
     return *this;
   }
 
   Matrix operator * (const Matrix& a) const {
-    // TODO check that this.cols = a.rows
+    if(this->cols != a.rows) {
+      std::cout << "Cannot multiply a " << rows << "x" << cols << " matrix by a " << a.rows << "x" << a.cols << " matrix." << std::endl;
+      exit(1);
+    }
     Matrix res(this->rows, a.cols);
+    gemm(rows, a.cols, cols, buf, cols, 1, a.buf, a.cols, 1, res.buf, res.cols, 1);
+    return res;
+  }
 
-    for(size_t r=0; r<res.rows; r++) {
-      for(size_t c=0; c<res.cols; c++) {
-        res.set(r, c, 0);
-        auto tmp = res.get(r,c);
-        for(size_t k=0; k<this->cols; k++) {
-          tmp += this->get(r, k) * a.get(k, c);
-        }
-        res.set(r, c, tmp);
-      }
+  std::vector<T> operator * (const std::vector<T>& a) const {
+    if(this->cols != a.size()) {
+      std::cout << "Cannot multiply a " << rows << "x" << cols << " matrix by a vector of size " << a.size() << "." << std::endl;
+      exit(1);
     }
+    std::vector<T> res(this->rows);
+    gemv(rows, cols, buf, cols, 1, a.data(), res.data());
     return res;
   }
 
-  Matrix operator * (const T& a) const {
-    Matrix res(this->rows, this->cols);
-    for(size_t r=0; r<res.rows; r++) {
-      for(size_t c=0; c<res.cols; c++) {
-        res.set(r, c, this->get(r, c) * a);
+  // Attributes
+  private:
+    // Elementwise evaluation, in place: without views, element i of e only
+    // depends on element i of its operands, so e can reference this matrix
+    template <typename E>
+    void assign(const E& e) {
+      for(size_t i=0; i<rows*cols; i++)
+        buf[i] = e.at(i);
+    }
+
+    void check_size(size_t r, size_t c) const {
+      if(r != rows || c != cols) {
+        std::cout << "Size mismatch: " << rows << "x" << cols << " and " << r << "x" << c << "." << std::endl;
+        exit(1);
       }
     }
-    return res;
+
+    T * buf;
+    size_t rows;
+    size_t cols;
+};
+
+// Non-owning views: element (r, c) is ptr[r*rs + c*cs]. Sub-blocks,
+// transposes and rows of a view are views of the same buffer, so block
+// algorithms can work on them without copies. The viewed buffer must outlive them.
+template <typename T>
+struct ConstMatrixView : MatExpr<ConstMatrixView<T>> {
+  // Constructors
+  ConstMatrixView(const T* ptr, size_t rows, size_t cols, size_t rs, size_t cs = 1)
+  : ptr { ptr }, rows { rows }, cols { cols }, rs { rs }, cs { cs } {
   }
 
-  std::vector<T> operator * (const std::vector<T>& a) const {
-    // TODO check that this.cols = a.size()
-    std::vector<T> res(a.size());
+  ConstMatrixView(const Matrix<T>& m)
+  : ConstMatrixView(m.data(), m.r(), m.c(), m.c(), 1) {
+  }
 
-    for(size_t r=0; r<this->rows; r++) {
-      res[r] = 0;
-      for(size_t c=0; c<this->cols; c++) {
-        res[r] += this->get(r, c) * a[c];
-      }
+  // Methods
+  size_t r() const { return rows; }
+  size_t c() const { return cols; }
+  size_t row_stride() const { return rs; }
+  size_t col_stride() const { return cs; }
+  const T* data() const { return ptr; }
+
+  const T& operator()(const size_t r, const size_t c) const {
+    return ptr[r*rs + c*cs];
+  }
+
+  T at(const size_t i) const {
+    return (*this)(i / cols, i % cols);
+  }
+
+  ConstMatrixView sub(size_t r0, size_t c0, size_t nr, size_t nc) const {
+    return { ptr + r0*rs + c0*cs, nr, nc, rs, cs };
+  }
+
+  ConstMatrixView t() const {
+    return { ptr, cols, rows, cs, rs };
+  }
+
+  ConstMatrixView row(size_t r) const {
+    return sub(r, 0, 1, cols);
+  }
+
+  ConstMatrixView col(size_t c) const {
+    return sub(0, c, rows, 1);
+  }
+
+  // Attributes
+  private:
+    const T* ptr;
+    size_t rows;
+    size_t cols;
+    size_t rs;
+    size_t cs;
+};
+
+template <typename T>
+struct MatrixView : MatExpr<MatrixView<T>> {
+  // Constructors
+  MatrixView(T* ptr, size_t rows, size_t cols, size_t rs, size_t cs = 1)
+  : ptr { ptr }, rows { rows }, cols { cols }, rs { rs }, cs { cs } {
+  }
+
+  MatrixView(Matrix<T>& m)
+  : MatrixView(m.data(), m.r(), m.c(), m.c(), 1) {
+  }
+
+  // Copies the view, the assignment below copies the elements
+  MatrixView(const MatrixView&) = default;
+
+  operator ConstMatrixView<T>() const {
+    return { ptr, rows, cols, rs, cs };
+  }
+
+  // Write an expression of the same size in the viewed elements. The
+  // expression can read the viewed buffer in any order, so it is evaluated
+  // first.
+  template <typename E>
+  const MatrixView& operator=(const MatExpr<E>& e) const {
+    const E& x = e.self();
+    if(x.r() != rows || x.c() != cols) {
+      std::cout << "Size mismatch: " << rows << "x" << cols << " and " << x.r() << "x" << x.c() << "." << std::endl;
+      exit(1);
     }
-    return res;
+    Matrix<T> res(e);
+    for(size_t r=0; r<rows; r++)
+      for(size_t c=0; c<cols; c++)
+        (*this)(r, c) = res(r, c);
+    return *this;
+  }
+
+  const MatrixView& operator=(const MatrixView& other) const {
+    return *this = ConstMatrixView<T>(other);
+  }
+
+  // Methods
+  size_t r() const { return rows; }
+  size_t c() const { return cols; }
+  size_t row_stride() const { return rs; }
+  size_t col_stride() const { return cs; }
+  T* data() const { return ptr; }
+
+  T& operator()(const size_t r, const size_t c) const {
+    return ptr[r*rs + c*cs];
+  }
+
+  T at(const size_t i) const {
+    return (*this)(i / cols, i % cols);
+  }
+
+  MatrixView sub(size_t r0, size_t c0, size_t nr, size_t nc) const {
+    return { ptr + r0*rs + c0*cs, nr, nc, rs, cs };
+  }
+
+  MatrixView t() const {
+    return { ptr, cols, rows, cs, rs };
+  }
+
+  MatrixView row(size_t r) const {
+    return sub(r, 0, 1, cols);
+  }
+
+  MatrixView col(size_t c) const {
+    return sub(0, c, rows, 1);
   }
 
   // Attributes
   private:
-    T * buf;
+    T* ptr;
     size_t rows;
     size_t cols;
+    size_t rs;
+    size_t cs;
 };
 
 template <typename T>
-Matrix<T> kronecker(Matrix<T>& A, Matrix<T>& B) {
-  Matrix<T> res(A.r() * B.r(), A.c() * B.c());
+struct MatStrided<ConstMatrixView<T>> {
+  static constexpr bool value = true;
+};
+
+template <typename T>
+struct MatStrided<MatrixView<T>> {
+  static constexpr bool value = true;
+};
+
+template <typename T>
+MatrixView<T> Matrix<T>::view() {
+  return MatrixView<T>(*this);
+}
+
+template <typename T>
+ConstMatrixView<T> Matrix<T>::view() const {
+  return ConstMatrixView<T>(*this);
+}
+
+// C = A * B + beta * C, straight on the views
+template <typename T>
+void gemm(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C, T beta = 0, size_t threads = 0) {
+  if(A.c() != B.r() || C.r() != A.r() || C.c() != B.c()) {
+    std::cout << "Cannot multiply a " << A.r() << "x" << A.c() << " matrix by a " << B.r() << "x" << B.c() << " matrix into a " << C.r() << "x" << C.c() << " matrix." << std::endl;
+    exit(1);
+  }
+  gemm(A.r(), B.c(), A.c(),
+       A.data(), A.row_stride(), A.col_stride(),
+       B.data(), B.row_stride(), B.col_stride(),
+       C.data(), C.row_stride(), C.col_stride(),
+       beta, threads);
+}
+
+template <typename T>
+Matrix<T> operator * (ConstMatrixView<T> A, ConstMatrixView<T> B) {
+  Matrix<T> res(A.r(), B.c());
+  gemm(A, B, res.view());
+  return res;
+}
+
+// Matrices are held by reference in the expressions, the other nodes by value
+template <typename E>
+struct MatOperand {
+  using type = const E;
+};
+
+template <typename T>
+struct MatOperand<Matrix<T>> {
+  using type = const Matrix<T>&;
+};
+
+// Read-only view of a std::vector as a column expression
+template <typename T>
+struct VecRef : MatExpr<VecRef<T>> {
+  VecRef(const std::vector<T>& v) : v { v } { }
+
+  size_t r() const { return v.size(); }
+  size_t c() const { return 1; }
+  T at(const size_t i) const { return v[i]; }
+
+  const std::vector<T>& v;
+};
+
+template <typename T>
+VecRef<T> vec(const std::vector<T>& v) {
+  return VecRef<T>(v);
+}
+
+// y = e, evaluated in one loop
+template <typename T, typename E>
+void assign(std::vector<T>& y, const MatExpr<E>& e) {
+  const E& x = e.self();
+  y.resize(x.r() * x.c());
+  for(size_t i=0; i<y.size(); i++)
+    y[i] = x.at(i);
+}
+
+template <typename L, typename R, typename Op>
+struct MatBinary : MatExpr<MatBinary<L, R, Op>> {
+  MatBinary(const L& l, const R& r) : lhs { l }, rhs { r } {
+    if(l.r() != r.r() || l.c() != r.c()) {
+      std::cout << "Size mismatch: " << l.r() << "x" << l.c() << " and " << r.r() << "x" << r.c() << "." << std::endl;
+      exit(1);
+    }
+  }
+
+  size_t r() const { return lhs.r(); }
+  size_t c() const { return lhs.c(); }
+  auto at(const size_t i) const { return Op::apply(lhs.at(i), rhs.at(i)); }
+
+  typename MatOperand<L>::type lhs;
+  typename MatOperand<R>::type rhs;
+};
+
+template <typename E, typename S>
+struct MatScale : MatExpr<MatScale<E, S>> {
+  MatScale(const E& e, const S& s) : e { e }, s { s } { }
+
+  size_t r() const { return e.r(); }
+  size_t c() const { return e.c(); }
+  auto at(const size_t i) const { return e.at(i) * s; }
+
+  typename MatOperand<E>::type e;
+  S s;
+};
+
+template <typename L, typename R, typename Op>
+struct MatStrided<MatBinary<L, R, Op>> {
+  static constexpr bool value = MatStrided<L>::value || MatStrided<R>::value;
+};
+
+template <typename E, typename S>
+struct MatStrided<MatScale<E, S>> {
+  static constexpr bool value = MatStrided<E>::value;
+};
+
+struct MatAdd {
+  template <typename A, typename B>
+  static auto apply(const A& a, const B& b) { return a + b; }
+};
+
+struct MatSub {
+  template <typename A, typename B>
+  static auto apply(const A& a, const B& b) { return a - b; }
+};
+
+template <typename L, typename R>
+MatBinary<L, R, MatAdd> operator + (const MatExpr<L>& l, const MatExpr<R>& r) {
+  return { l.self(), r.self() };
+}
+
+template <typename L, typename R>
+MatBinary<L, R, MatSub> operator - (const MatExpr<L>& l, const MatExpr<R>& r) {
+  return { l.self(), r.self() };
+}
+
+template <typename E, typename S> requires std::is_arithmetic_v<S>
+MatScale<E, S> operator * (const MatExpr<E>& e, const S& s) {
+  return { e.self(), s };
+}
+
+template <typename E, typename S> requires std::is_arithmetic_v<S>
+MatScale<E, S> operator * (const S& s, const MatExpr<E>& e) {
+  return { e.self(), s };
+}
+
+template <typename E, typename S> requires std::is_floating_point_v<S>
+MatScale<E, S> operator / (const MatExpr<E>& e, const S& s) {
+  return { e.self(), S(1) / s };
+}
+
+// res = A x B, written in a view of size (A.r() * B.r()) x (A.c() * B.c())
+template <typename T>
+void kronecker(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> res) {
+  if(res.r() != A.r() * B.r() || res.c() != A.c() * B.c()) {
+    std::cout << "Wrong size for the Kronecker product: " << res.r() << "x" << res.c() << "." << std::endl;
+    exit(1);
+  }
 
   for(size_t r=0; r<A.r(); r++) {
     for(size_t c=0; c<A.c(); c++) {
-      Matrix<T> tmp(B.r(), B.c());
-      tmp = B * A.get(r, c);
-      // Copy tmp to res
+      T a = A(r, c);
+      // Copy a * B to its block of res
+      MatrixView<T> block = res.sub(r*B.r(), c*B.c(), B.r(), B.c());
       for(size_t rr=0; rr<B.r(); rr++) {
         for(size_t cc=0; cc<B.c(); cc++) {
-          res.set(r*B.r() + rr, c*B.c() + cc, tmp.get(rr, cc));
+          block(rr, cc) = a * B(rr, cc);
         }
       }
-
     }
   }
+}
 
+template <typename T>
+Matrix<T> kronecker(const Matrix<T>& A, const Matrix<T>& B) {
+  Matrix<T> res(A.r() * B.r(), A.c() * B.c());
+  kronecker<T>(A.view(), B.view(), res.view());
   return res;
 }
+
+#endif
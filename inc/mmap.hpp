@@ -0,0 +1,94 @@
+#ifndef MMAP_H
+#define MMAP_H
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+struct MappedFile {
+  // Constructors
+  MappedFile() = default;
+
+  MappedFile(const std::string& filename) {
+    open(filename);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if(this == &other) return *this;
+    close();
+    ptr = other.ptr;
+    len = other.len;
+    other.ptr = nullptr;
+    other.len = 0;
+    return *this;
+  }
+
+  // Destructor
+  ~MappedFile() {
+    close();
+  }
+
+  // Methods
+  void open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+      std::cout << "Cannot stat " << filename << std::endl;
+      exit(1);
+    }
+    len = st.st_size;
+
+    if(len > 0) {
+      void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p == MAP_FAILED) {
+        std::cout << "Cannot map " << filename << std::endl;
+        exit(1);
+      }
+      ptr = (const unsigned char*)p;
+      // The file is read front to back
+      madvise(p, len, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  void close() {
+    if(ptr != nullptr)
+      munmap((void*)ptr, len);
+    ptr = nullptr;
+    len = 0;
+  }
+
+  const unsigned char* data() const {
+    return ptr;
+  }
+
+  size_t size() const {
+    return len;
+  }
+
+  // Attributes
+  private:
+    const unsigned char* ptr = nullptr;
+    size_t len = 0;
+};
+
+#endif
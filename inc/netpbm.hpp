@@ -1,169 +1,329 @@
+#ifndef NETPBM_H
+#define NETPBM_H
+
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 #include <cmath>
+#include <charconv>
+
+#include "mmap.hpp"
+#include "pixel.hpp"
+#include "plain.hpp"
+
+inline uint8_t rgb_to_grayscale(uint8_t red, uint8_t green, uint8_t blue) {
+  return luma(red, green, blue);
+}
+
+inline uint16_t rgb_to_grayscale(uint16_t red, uint16_t green, uint16_t blue) {
+  return luma(red, green, blue);
+}
+
+// Reader of the whitespace-separated ASCII fields of a netpbm header,
+// skipping the comments (from '#' to the end of the line)
+struct NetpbmTokenizer {
+  // Constructor
+  NetpbmTokenizer(const unsigned char* data, size_t size)
+  : p { data }, end { data + size } {}
+
+  // Methods
+  std::string next() {
+    skip();
+    const unsigned char* begin = p;
+    while(p < end && !isspace(*p) && *p != '#')
+      p++;
+    return std::string(begin, p);
+  }
+
+  int next_int() {
+    std::string s = next();
+    int v = 0;
+    auto [last, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if(s.empty() || ec != std::errc() || last != s.data() + s.size() || v < 0) {
+      std::cout << "Error in the netpbm header." << std::endl;
+      exit(1);
+    }
+    return v;
+  }
+
+  // Where the next field is searched
+  const unsigned char* position() const {
+    return p;
+  }
+
+  // Offset of the raster: a single whitespace follows the last field
+  size_t raster_offset(const unsigned char* data) const {
+    return (p < end) ? p + 1 - data : p - data;
+  }
+
+  // Attributes
+  private:
+    void skip() {
+      while(p < end) {
+        if(*p == '#') {
+          while(p < end && *p != '\n')
+            p++;
+        }
+        else if(isspace(*p)) {
+          p++;
+        }
+        else {
+          break;
+        }
+      }
+    }
+
+    const unsigned char* p;
+    const unsigned char* end;
+};
+
+// Magic number, size and maximum value (1 for P1 and P4, which have none)
+inline void read_netpbm_header(NetpbmTokenizer& tok, const std::string& filename, std::string& magic_number, int& width, int& height, int& max) {
+  magic_number = tok.next();
+  if(magic_number.size() != 2 || magic_number[0] != 'P' || magic_number[1] < '1' || magic_number[1] > '6') {
+    std::cout << filename << " is not a netpbm image." << std::endl;
+    exit(1);
+  }
+  width = tok.next_int();
+  height = tok.next_int();
+  max = 1;
+  if(magic_number != "P1" && magic_number != "P4") {
+    max = tok.next_int();
+    if(max < 1 || max > 65535) {
+      std::cout << "Error in the maximum value " << max << std::endl;
+      exit(1);
+    }
+  }
+}
 
-uint8_t rgb_to_grayscale(uint8_t red, uint8_t green, uint8_t blue) {
-  return round(0.299 * red + 0.587 * green + 0.114 * blue);
+// max = 0 for P1 and P4, which have no maximum value
+inline std::string netpbm_header(const std::string& magic_number, size_t width, size_t height, int max) {
+  std::string header = magic_number + "\n" + std::to_string(width) + " " + std::to_string(height) + "\n";
+  if(max > 0)
+    header += std::to_string(max) + "\n";
+  return header;
 }
 
+// Netpbm image. Binary files (P4, P5, P6) are decoded in place from a
+// memory mapping of the file; other images own their pixels. Samples are
+// one byte, or two big-endian bytes when the maximum value is above 255.
+// P4 rows are packed 8 pixels per byte (1 = black), padded to whole bytes.
 struct netpbm {
-  bool is_baw() {
+  // Constructors
+  netpbm() = default;
+
+  // Image from its pixels: one sample per pixel for P5, three for P6
+  netpbm(std::string magic_number, int width, int height, int max, const uint8_t* data)
+  : magic_number { magic_number }, width { width }, height { height }, max { max } {
+    get_size();
+    storage.assign(data, data + size);
+    pixels = storage.data();
+  }
+
+  netpbm(const netpbm&) = delete;
+  netpbm& operator=(const netpbm&) = delete;
+  netpbm(netpbm&&) = default;
+  netpbm& operator=(netpbm&&) = default;
+
+  bool is_baw() const {
     return (magic_number == "P1" or magic_number == "P4");
   }
 
-  bool is_gray() {
+  bool is_gray() const {
     return (magic_number == "P2" or magic_number == "P5");
   }
 
-  bool is_rgb() {
+  bool is_rgb() const {
     return (magic_number == "P3" or magic_number == "P6");
   }
 
+  int get_width() const {
+    return width;
+  }
+
+  int get_height() const {
+    return height;
+  }
+
+  int get_max() const {
+    return max;
+  }
+
+  // Bytes per sample
+  size_t get_depth() const {
+    return (max > 255) ? 2 : 1;
+  }
+
+  // Raster as in a binary file
+  const uint8_t* data() const {
+    return pixels;
+  }
+
+  size_t get_bytes() const {
+    return size;
+  }
+
+  // Bytes of the raster
   void get_size() {
-    if(this->is_rgb())
-      size = 3*width*height;
+    if(this->is_baw())
+      size = (size_t)(width + 7) / 8 * height;
+    else if(this->is_rgb())
+      size = 3 * (size_t)width * height * get_depth();
     else
-      size = width*height;
+      size = (size_t)width * height * get_depth();
   }
 
   void decoder(std::string filename) {
-    std::ifstream fsi(filename, std::ios::binary);
-    if(fsi.is_open()) {
-      std::string width_s, height_s, max_s;
-  
-      // First line
-      getline(fsi, magic_number);
-  
-      // Second line
-      getline(fsi, width_s, ' ');
-      width = stoi(width_s);
-      getline(fsi, height_s);
-      height = stoi(height_s);
-  
-      get_size();
-
-      if(magic_number != "P1" && magic_number != "P4") {
-        // Third line
-        getline(fsi, max_s);
-        max = stoi(max_s);
-        if(this->is_rgb()) {
-          if(max != 255) {
-            std::cout << "err" << std::endl;
-            exit(1);
-          }
-        }
-      }
+    file.open(filename);
+    storage.clear();
+
+    NetpbmTokenizer tok(file.data(), file.size());
+    read_netpbm_header(tok, filename, magic_number, width, height, max);
+    get_size();
 
-      // Rest of the file
-      pixels = new char[size];
-      fsi.read(pixels, size*sizeof(char));
-  
-      fsi.close();
+    if(magic_number[1] >= '4') {
+      // Binary: the raster is used where it is in the file
+      size_t offset = tok.raster_offset(file.data());
+      if(offset + size > file.size()) {
+        std::cout << filename << " is truncated." << std::endl;
+        exit(1);
+      }
+      pixels = file.data() + offset;
     }
     else {
-      std::cout << "Cannot open " << filename << std::endl;
-      exit(1);
+      decode_plain((const char*)tok.position(), (const char*)file.data() + file.size());
+      file.close();
     }
   }
 
-  void encoder(std::string filename_, std::string ext) {
+  // With error_diffusion, pbm images are dithered instead of thresholded.
+  // With plain, the ASCII format (P1, P2, P3) is written.
+  // The image is written to a temporary file renamed at the end: the raster
+  // may still be read from the mapping of the file that is replaced.
+  void encoder(std::string filename_, std::string ext, bool error_diffusion = false, bool plain = false) {
     std::string filename = filename_ + "." + ext;
-    std::ofstream fso(filename, std::ios::binary);
+
+    // From B&W or grayscale to RGB, from B&W to grayscale
+    if(ext == "ppm" && !this->is_rgb()) {
+      std::cout << "Can't convert " << (this->is_baw() ? "pbm" : "pgm") << " to ppm." << std::endl;
+      exit(1);
+    }
+    if(ext == "pgm" && this->is_baw()) {
+      std::cout << "Can't convert pbm to pgm." << std::endl;
+      exit(1);
+    }
+
+    std::string tmp_filename = filename + ".tmp";
+    std::ofstream fso(tmp_filename, std::ios::binary);
 
     if(fso.is_open()) {
+      std::vector<uint8_t> out;
+
       // Save RGB file
       if(ext == "ppm") {
-        // From B&W
-        if (this->is_baw()) {
-          std::cout << "Can't convert pbm to ppm." << std::endl;
-          exit(1);
-        }
-        // From Grayscale
-        if (this->is_gray()) {
-          std::cout << "Can't convert pgm to ppm." << std::endl;
-          exit(1);
-        }
-        // From RGB
-        fso << "P6" << std::endl;
-        fso << width << " " << height << std::endl;
-        fso << max << std::endl;
-        for(size_t i=0; i<size; i++)
-          fso << pixels[i];
+        write_image(fso, '6', max, pixels, plain);
       }
 
       // Save grayscale file
       if(ext == "pgm") {
-        // From B&W
-        if (this->is_baw()) {
-          std::cout << "Can't convert pbm to pgm." << std::endl;
-          exit(1);
-        }
-
-        fso << "P5" << std::endl;
-        fso << width << " " << height << std::endl;
-        fso << max << std::endl;
         // From RGB
         if (this->is_rgb()) {
-          for(size_t i=0; i<size/3; i++)
-            fso << rgb_to_grayscale((uint8_t)pixels[3*i], (uint8_t)pixels[3*i + 1], (uint8_t)pixels[3*i + 2]);
+          gray_raster(out);
+          write_image(fso, '5', max, out.data(), plain);
         }
         // From grayscale
         if (this->is_gray()) {
-          for(size_t i=0; i<size; i++)
-            fso << pixels[i];
+          write_image(fso, '5', max, pixels, plain);
         }
       }
 
       // Save black and white file
       if(ext == "pbm") {
-        fso << "P4" << std::endl;
-        fso << width << " " << height << std::endl;
-        // From RGB
-        if (this->is_rgb()) {
-          for(size_t i=0; i<size/3 >> 3; i++) {
-            uint8_t tmp = 0b00000000;
-            for(size_t j=0; j<8; j++) {
-              if(rgb_to_grayscale((uint8_t)pixels[3*(8*i + j)], (uint8_t)pixels[3*(8*i + j) + 1], (uint8_t)pixels[3*(8*i + j) + 2]) < 128) {
-                tmp |= (0b10000000 >> j);
-              }
-            }
-            fso << tmp;
-          }
-        }
-        // From grayscale
-        if (this->is_gray()) {
-          for(size_t i=0; i<size >> 3; i++) {
-            uint8_t tmp = 0b00000000;
-            for(size_t j=0; j<8; j++) {
-              if((uint8_t)pixels[8*i + j] < 128) {
-                tmp |= (0b10000000 >> j);
-              }
-            }
-            fso << tmp;
+        // From RGB or grayscale: below half the maximum value is black
+        if (!this->is_baw()) {
+          std::vector<uint8_t> gray;
+          const uint8_t* g = pixels;
+          if (this->is_rgb()) {
+            gray_raster(gray);
+            g = gray.data();
           }
+          out.resize((size_t)(width + 7) / 8 * height);
+          if(error_diffusion)
+            dither(g, out.data(), width, height, get_depth(), max);
+          else
+            binarize(g, out.data(), width, height, get_depth(), (max + 1) / 2);
+          write_image(fso, '4', 0, out.data(), plain);
         }
         // From B&W
         if (this->is_baw()) {
-          for(size_t i=0; i<size >> 3; i++) {
-            fso << pixels[i];
-          }
+          write_image(fso, '4', 0, pixels, plain);
         }
       }
-  
+
       fso.close();
+      if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        std::cout << "Cannot write " << filename << std::endl;
+        exit(1);
+      }
     }
     else {
-      std::cout << "Cannot open " << filename << std::endl;
+      std::cout << "Cannot open " << tmp_filename << std::endl;
       exit(1);
     }
   }
 
   private:
+    // Grayscale raster of an RGB image, with the same depth
+    void gray_raster(std::vector<uint8_t>& out) const {
+      out.resize((size_t)width * height * get_depth());
+      rgb_to_gray(pixels, out.data(), width, height, get_depth());
+    }
+
+    // Header and raster of a binary format ('4', '5' or '6'), or of the
+    // matching plain format ('1', '2' or '3')
+    void write_image(std::ofstream& fso, char binary, int max, const uint8_t* raster, bool plain) const {
+      char magic = plain ? binary - 3 : binary;
+      std::string header = netpbm_header(std::string("P") + magic, width, height, max);
+      fso.write(header.data(), header.size());
+      if(plain) {
+        write_plain_raster(fso, raster, magic, width, height, get_depth());
+      }
+      else {
+        size_t bytes = (size_t)width * height * get_depth();
+        if(binary == '4')
+          bytes = (size_t)(width + 7) / 8 * height;
+        else if(binary == '6')
+          bytes *= 3;
+        fso.write((const char*)raster, bytes);
+      }
+    }
+
+    // ASCII samples (P1: one digit per pixel, possibly without spaces),
+    // parsed in parallel and stored as the equivalent binary raster
+    void decode_plain(const char* begin, const char* end) {
+      storage.assign(size, 0);
+      if(this->is_baw()) {
+        std::vector<uint8_t> bits((size_t)width * height);
+        parse_plain_bits(begin, end, bits.data(), bits.size());
+        binarize(bits.data(), storage.data(), width, height, 1, 1);
+      }
+      else {
+        parse_plain_samples(begin, end, storage.data(), size / get_depth(), get_depth(), max);
+      }
+      pixels = storage.data();
+    }
+
     std::string magic_number;
-    int width, height, max;
-    char * pixels;
-    size_t size;
+    int width = 0, height = 0, max = 0;
+    const uint8_t* pixels = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> storage;
+    MappedFile file;
 };
 
-
+#endif
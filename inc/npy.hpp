@@ -0,0 +1,96 @@
+#ifndef NPY_H
+#define NPY_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <bit>
+#include <type_traits>
+
+// Writer of 2D arrays in the NumPy .npy format (version 1.0, C order), so
+// that the output can be opened with numpy.load(..., mmap_mode='r').
+// Rows are appended one after the other: the number of rows goes in the
+// header, which is rewritten with the same length on close().
+template <typename T>
+struct NpyWriter {
+  // Constructor
+  NpyWriter(const std::string& filename, size_t cols)
+  : cols { cols } {
+    if(std::endian::native != std::endian::little) {
+      std::cout << "The .npy writer only supports little-endian machines." << std::endl;
+      exit(1);
+    }
+    fs.open(filename, std::ios::binary);
+    if(!fs.is_open()) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+    write_header();
+  }
+
+  NpyWriter(const NpyWriter&) = delete;
+  NpyWriter& operator=(const NpyWriter&) = delete;
+
+  // Destructor
+  ~NpyWriter() {
+    close();
+  }
+
+  // Methods
+  void write_row(const T* row) {
+    fs.write((const char*)row, cols * sizeof(T));
+    rows++;
+  }
+
+  // count rows stored one after the other
+  void write_rows(const T* data, size_t count) {
+    fs.write((const char*)data, count * cols * sizeof(T));
+    rows += count;
+  }
+
+  size_t num_rows() const {
+    return rows;
+  }
+
+  void close() {
+    if(!fs.is_open())
+      return;
+    fs.seekp(0);
+    write_header();
+    fs.close();
+  }
+
+  // Attributes
+  private:
+    static const char* descr() {
+      if constexpr(std::is_same_v<T, float>)         return "<f4";
+      else if constexpr(std::is_same_v<T, double>)   return "<f8";
+      else if constexpr(std::is_same_v<T, uint8_t>)  return "|u1";
+      else if constexpr(std::is_same_v<T, int16_t>)  return "<i2";
+      else if constexpr(std::is_same_v<T, int32_t>)  return "<i4";
+      else static_assert(sizeof(T) == 0, "Type not supported by the .npy writer");
+    }
+
+    // Magic string, version, header length, then the dictionary padded with
+    // spaces to a fixed 128 bytes, enough for any number of rows
+    void write_header() {
+      const size_t total = 128;
+      std::string dict = std::string("{'descr': '") + descr() + "', 'fortran_order': False, 'shape': ("
+                       + std::to_string(rows) + ", " + std::to_string(cols) + "), }";
+      dict.resize(total - 10 - 1, ' ');
+      dict += '\n';
+
+      uint16_t len = dict.size();
+      fs.write("\x93NUMPY\x01\x00", 8);
+      fs.write((const char*)&len, 2);
+      fs.write(dict.data(), dict.size());
+    }
+
+    std::ofstream fs;
+    size_t cols;
+    size_t rows = 0;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+// Number of worker threads (0 = all the hardware threads)
+inline size_t num_threads(size_t requested = 0) {
+  if(requested > 0)
+    return requested;
+  size_t hw = std::thread::hardware_concurrency();
+  return hw > 0 ? hw : 1;
+}
+
+// Split [0, n) in one contiguous range per thread and call f(begin, end) on each.
+// Each range is handled by a single call, so f can allocate its scratch once.
+template <typename F>
+void parallel_for(size_t n, F f, size_t threads = 0) {
+  size_t T = std::min(num_threads(threads), n);
+  if(T <= 1) {
+    if(n > 0)
+      f(0, n);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t chunk = n / T;
+  size_t extra = n % T;
+  size_t begin = 0;
+  for(size_t t=0; t<T; t++) {
+    size_t end = begin + chunk + (t < extra ? 1 : 0);
+    if(t == T - 1)
+      f(begin, end); // The calling thread takes the last range
+    else
+      workers.emplace_back(f, begin, end);
+    begin = end;
+  }
+
+  for(auto& w : workers)
+    w.join();
+}
+
+// Call f(task, worker) on each task of [0, n). The workers take the next
+// task when they are done with the previous one, so tasks of uneven cost
+// keep all the threads busy; worker is in [0, threads) and can index
+// per-thread scratch.
+template <typename F>
+void parallel_tasks(size_t n, F f, size_t threads = 0) {
+  size_t T = std::min(num_threads(threads), n);
+  if(T <= 1) {
+    for(size_t i=0; i<n; i++)
+      f(i, 0);
+    return;
+  }
+
+  std::atomic<size_t> next = 0;
+  auto work = [&](size_t worker) {
+    for(size_t i=next++; i<n; i=next++)
+      f(i, worker);
+  };
+  std::vector<std::thread> workers;
+  for(size_t t=0; t<T-1; t++)
+    workers.emplace_back(work, t);
+  work(T - 1); // The calling thread is the last worker
+
+  for(auto& w : workers)
+    w.join();
+}
+
+#endif
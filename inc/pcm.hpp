@@ -0,0 +1,368 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <type_traits>
+
+// Conversion of little-endian PCM samples to numbers, and back.
+// Each format has its own loop, without branches per sample, so the
+// compiler can vectorize the byte assembly. Values are the integer sample
+// values (8-bit samples are shifted from unsigned to signed, A-law and
+// mu-law are expanded to 16 bits), or [-1, 1] for floating point samples,
+// times an optional scale (e.g. 1 / pcm_full_scale() to get [-1, 1]).
+
+enum class PcmFormat { uint8, int16, int24, int32, float32, float64, alaw, mulaw };
+
+// Format from the WAV format code (1=PCM, 3=IEEE float, 6=A-law, 7=mu-law) and width
+inline PcmFormat pcm_format(unsigned int audio_format, unsigned int bits_per_sample) {
+  if(audio_format == 1) {
+    switch(bits_per_sample) {
+      case 8:  return PcmFormat::uint8;
+      case 16: return PcmFormat::int16;
+      case 24: return PcmFormat::int24;
+      case 32: return PcmFormat::int32;
+    }
+  }
+  else if(audio_format == 3) {
+    switch(bits_per_sample) {
+      case 32: return PcmFormat::float32;
+      case 64: return PcmFormat::float64;
+    }
+  }
+  else if(audio_format == 6 && bits_per_sample == 8) {
+    return PcmFormat::alaw;
+  }
+  else if(audio_format == 7 && bits_per_sample == 8) {
+    return PcmFormat::mulaw;
+  }
+  std::cout << "Audio format " << audio_format << " with " << bits_per_sample << " bits per sample is not supported." << std::endl;
+  exit(1);
+}
+
+constexpr size_t pcm_bytes(PcmFormat f) {
+  switch(f) {
+    case PcmFormat::int16:   return 2;
+    case PcmFormat::int24:   return 3;
+    case PcmFormat::int32:   return 4;
+    case PcmFormat::float32: return 4;
+    case PcmFormat::float64: return 8;
+    default:                 return 1;
+  }
+}
+
+// Magnitude of the most negative sample value
+constexpr double pcm_full_scale(PcmFormat f) {
+  switch(f) {
+    case PcmFormat::uint8:   return 128.0;
+    case PcmFormat::int24:   return 8388608.0;
+    case PcmFormat::int32:   return 2147483648.0;
+    case PcmFormat::float32: return 1.0;
+    case PcmFormat::float64: return 1.0;
+    default:                 return 32768.0;
+  }
+}
+
+constexpr bool pcm_is_integer(PcmFormat f) {
+  return f == PcmFormat::uint8 || f == PcmFormat::int16 || f == PcmFormat::int24 || f == PcmFormat::int32;
+}
+
+// Call fn with the format as a compile-time constant
+template <typename F>
+void pcm_dispatch(PcmFormat f, F&& fn) {
+  switch(f) {
+    case PcmFormat::uint8:   fn(std::integral_constant<PcmFormat, PcmFormat::uint8>());   break;
+    case PcmFormat::int16:   fn(std::integral_constant<PcmFormat, PcmFormat::int16>());   break;
+    case PcmFormat::int24:   fn(std::integral_constant<PcmFormat, PcmFormat::int24>());   break;
+    case PcmFormat::int32:   fn(std::integral_constant<PcmFormat, PcmFormat::int32>());   break;
+    case PcmFormat::float32: fn(std::integral_constant<PcmFormat, PcmFormat::float32>()); break;
+    case PcmFormat::float64: fn(std::integral_constant<PcmFormat, PcmFormat::float64>()); break;
+    case PcmFormat::alaw:    fn(std::integral_constant<PcmFormat, PcmFormat::alaw>());    break;
+    case PcmFormat::mulaw:   fn(std::integral_constant<PcmFormat, PcmFormat::mulaw>());   break;
+  }
+}
+
+// G.711 companding (after the reference implementation by Sun Microsystems)
+inline int16_t alaw_to_linear(unsigned char a) {
+  a ^= 0x55;
+  int t = (a & 0x0F) << 4;
+  int seg = (a & 0x70) >> 4;
+  if(seg == 0)
+    t += 8;
+  else
+    t = (t + 0x108) << (seg - 1);
+  return (a & 0x80) ? t : -t;
+}
+
+inline int16_t mulaw_to_linear(unsigned char u) {
+  u = ~u;
+  int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+  return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+inline unsigned char linear_to_alaw(int16_t pcm) {
+  int v = pcm >> 3;
+  int mask = 0xD5;
+  if(v < 0) {
+    mask = 0x55;
+    v = -v - 1;
+  }
+  int seg = 0;
+  while(seg < 8 && v > (0x20 << seg) - 1)
+    seg++;
+  if(seg >= 8)
+    return 0x7F ^ mask;
+  int a = (seg << 4) | ((v >> (seg < 2 ? 1 : seg)) & 0x0F);
+  return a ^ mask;
+}
+
+inline unsigned char linear_to_mulaw(int16_t pcm) {
+  int v = pcm >> 2;
+  int mask = 0xFF;
+  if(v < 0) {
+    mask = 0x7F;
+    v = -v;
+  }
+  v = std::min(v, 8159) + 0x21;
+  int seg = 0;
+  while(seg < 8 && v > (0x40 << seg) - 1)
+    seg++;
+  if(seg >= 8)
+    return 0x7F ^ mask;
+  int u = (seg << 4) | ((v >> (seg + 1)) & 0x0F);
+  return u ^ mask;
+}
+
+// Decoding table, built on first use
+template <PcmFormat F>
+const int16_t* companding_table() {
+  static const std::array<int16_t, 256> table = [] {
+    std::array<int16_t, 256> t;
+    for(int i=0; i<256; i++)
+      t[i] = (F == PcmFormat::alaw) ? alaw_to_linear(i) : mulaw_to_linear(i);
+    return t;
+  }();
+  return table.data();
+}
+
+// One sample
+template <PcmFormat F>
+inline auto pcm_decode(const unsigned char* p) {
+  if constexpr(F == PcmFormat::uint8) {
+    return (int32_t)p[0] - 128;
+  }
+  else if constexpr(F == PcmFormat::int16) {
+    return (int32_t)(int16_t)(p[0] | (p[1] << 8));
+  }
+  else if constexpr(F == PcmFormat::int24) {
+    // Assemble in the top bytes, then shift back to extend the sign
+    return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8;
+  }
+  else if constexpr(F == PcmFormat::int32) {
+    return (int32_t)((uint32_t)p[0]
+                   | ((uint32_t)p[1] << 8)
+                   | ((uint32_t)p[2] << 16)
+                   | ((uint32_t)p[3] << 24));
+  }
+  else if constexpr(F == PcmFormat::float32) {
+    return std::bit_cast<float>((uint32_t)p[0]
+                             | ((uint32_t)p[1] << 8)
+                             | ((uint32_t)p[2] << 16)
+                             | ((uint32_t)p[3] << 24));
+  }
+  else if constexpr(F == PcmFormat::float64) {
+    uint64_t u = 0;
+    for(int b=0; b<8; b++)
+      u |= (uint64_t)p[b] << (8*b);
+    return std::bit_cast<double>(u);
+  }
+  else {
+    return (int32_t)companding_table<F>()[p[0]];
+  }
+}
+
+// Round to the nearest integer and clip to [lo, hi]
+inline int32_t pcm_round_clip(double v, double lo, double hi) {
+  v = (v < lo) ? lo : ((v > hi) ? hi : v);
+  return (int32_t)((v < 0) ? v - 0.5 : v + 0.5);
+}
+
+template <PcmFormat F>
+inline void pcm_encode(double x, unsigned char* p) {
+  if constexpr(F == PcmFormat::uint8) {
+    p[0] = (unsigned char)(pcm_round_clip(x, -128, 127) + 128);
+  }
+  else if constexpr(F == PcmFormat::int16) {
+    int32_t v = pcm_round_clip(x, -32768, 32767);
+    p[0] = (unsigned char)(v     );
+    p[1] = (unsigned char)(v >> 8);
+  }
+  else if constexpr(F == PcmFormat::int24) {
+    int32_t v = pcm_round_clip(x, -8388608, 8388607);
+    p[0] = (unsigned char)(v      );
+    p[1] = (unsigned char)(v >>  8);
+    p[2] = (unsigned char)(v >> 16);
+  }
+  else if constexpr(F == PcmFormat::int32 || F == PcmFormat::float32) {
+    uint32_t u;
+    if constexpr(F == PcmFormat::int32)
+      u = (uint32_t)pcm_round_clip(x, -2147483648.0, 2147483647.0);
+    else
+      u = std::bit_cast<uint32_t>((float)x);
+    p[0] = (unsigned char)(u      );
+    p[1] = (unsigned char)(u >>  8);
+    p[2] = (unsigned char)(u >> 16);
+    p[3] = (unsigned char)(u >> 24);
+  }
+  else if constexpr(F == PcmFormat::float64) {
+    uint64_t u = std::bit_cast<uint64_t>(x);
+    for(int b=0; b<8; b++)
+      p[b] = (unsigned char)(u >> (8*b));
+  }
+  else if constexpr(F == PcmFormat::alaw) {
+    p[0] = linear_to_alaw(pcm_round_clip(x, -32768, 32767));
+  }
+  else {
+    p[0] = linear_to_mulaw(pcm_round_clip(x, -32768, 32767));
+  }
+}
+
+// Triangular (TPDF) dither of +-1 LSB, added before rounding to integer
+// PCM so that the quantization error does not follow the signal
+struct PcmDither {
+  // Constructor
+  PcmDither(uint32_t seed = 0x9E3779B9u)
+  : state { seed ? seed : 1 } {}
+
+  // Methods
+  double next() {
+    double a = step();
+    double b = step();
+    return (a - b) * (1.0 / 4294967296.0);
+  }
+
+  // Attributes
+  private:
+    // xorshift32
+    uint32_t step() {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+    }
+
+    uint32_t state;
+};
+
+template <PcmFormat F, typename T>
+void pcm_to_real(const unsigned char* src, size_t count, T* out, double scale) {
+  const size_t bytes = pcm_bytes(F);
+  if(scale == 1) {
+    for(size_t i=0; i<count; i++)
+      out[i] = T(pcm_decode<F>(src + i*bytes));
+  }
+  else {
+    for(size_t i=0; i<count; i++)
+      out[i] = T(pcm_decode<F>(src + i*bytes) * scale);
+  }
+}
+
+// count samples of format f from src to out
+template <typename T>
+void pcm_to_real(const unsigned char* src, size_t count, PcmFormat f, T* out, double scale = 1) {
+  pcm_dispatch(f, [&](auto F) { pcm_to_real<decltype(F)::value>(src, count, out, scale); });
+}
+
+template <PcmFormat F, typename T>
+void real_to_pcm(const T* in, size_t count, unsigned char* dst, double scale, PcmDither* dither) {
+  const size_t bytes = pcm_bytes(F);
+  if(dither != nullptr && pcm_is_integer(F)) {
+    for(size_t i=0; i<count; i++)
+      pcm_encode<F>((double)in[i] * scale + dither->next(), dst + i*bytes);
+  }
+  else {
+    for(size_t i=0; i<count; i++)
+      pcm_encode<F>((double)in[i] * scale, dst + i*bytes);
+  }
+}
+
+// count values from in to little-endian samples of format f in dst.
+// The dither, if any, is only added to integer PCM.
+template <typename T>
+void real_to_pcm(const T* in, size_t count, PcmFormat f, unsigned char* dst, double scale = 1, PcmDither* dither = nullptr) {
+  pcm_dispatch(f, [&](auto F) { real_to_pcm<decltype(F)::value>(in, count, dst, scale, dither); });
+}
+
+// Deinterleave while converting: frame i of channel c goes to out[c][i].
+// Stereo has its own loop with both outputs at a fixed offset; other
+// counts walk the frame once and write one value per channel buffer.
+template <PcmFormat F, typename T>
+void pcm_to_planar(const unsigned char* src, size_t frames, size_t channels, T* const* out, double scale) {
+  const size_t bytes = pcm_bytes(F);
+  if(channels == 1) {
+    pcm_to_real<F>(src, frames, out[0], scale);
+  }
+  else if(channels == 2) {
+    T* left = out[0];
+    T* right = out[1];
+    for(size_t i=0; i<frames; i++) {
+      left[i]  = T(pcm_decode<F>(src + 2*bytes*i) * scale);
+      right[i] = T(pcm_decode<F>(src + 2*bytes*i + bytes) * scale);
+    }
+  }
+  else {
+    for(size_t i=0; i<frames; i++) {
+      const unsigned char* frame = src + channels*bytes*i;
+      for(size_t c=0; c<channels; c++)
+        out[c][i] = T(pcm_decode<F>(frame + c*bytes) * scale);
+    }
+  }
+}
+
+template <typename T>
+void pcm_to_planar(const unsigned char* src, size_t frames, size_t channels, PcmFormat f, T* const* out, double scale = 1) {
+  pcm_dispatch(f, [&](auto F) { pcm_to_planar<decltype(F)::value>(src, frames, channels, out, scale); });
+}
+
+// Interleave while converting: in[c][i] becomes channel c of frame i
+template <PcmFormat F, typename T>
+void planar_to_pcm(const T* const* in, size_t frames, size_t channels, unsigned char* dst, double scale, PcmDither* dither) {
+  const size_t bytes = pcm_bytes(F);
+  if(channels == 1) {
+    real_to_pcm<F>(in[0], frames, dst, scale, dither);
+  }
+  else if(dither != nullptr && pcm_is_integer(F)) {
+    for(size_t i=0; i<frames; i++) {
+      unsigned char* frame = dst + channels*bytes*i;
+      for(size_t c=0; c<channels; c++)
+        pcm_encode<F>((double)in[c][i] * scale + dither->next(), frame + c*bytes);
+    }
+  }
+  else if(channels == 2) {
+    const T* left = in[0];
+    const T* right = in[1];
+    for(size_t i=0; i<frames; i++) {
+      pcm_encode<F>((double)left[i] * scale,  dst + 2*bytes*i);
+      pcm_encode<F>((double)right[i] * scale, dst + 2*bytes*i + bytes);
+    }
+  }
+  else {
+    for(size_t i=0; i<frames; i++) {
+      unsigned char* frame = dst + channels*bytes*i;
+      for(size_t c=0; c<channels; c++)
+        pcm_encode<F>((double)in[c][i] * scale, frame + c*bytes);
+    }
+  }
+}
+
+template <typename T>
+void planar_to_pcm(const T* const* in, size_t frames, size_t channels, PcmFormat f, unsigned char* dst, double scale = 1, PcmDither* dither = nullptr) {
+  pcm_dispatch(f, [&](auto F) { planar_to_pcm<decltype(F)::value>(in, frames, channels, dst, scale, dither); });
+}
+
+#endif
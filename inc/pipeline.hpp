@@ -0,0 +1,93 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstdio>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+// Ring of preallocated blocks between one producer and one consumer thread.
+// The producer fills the free blocks in order and pushes them, the consumer
+// pops them in the same order and releases them, so the two sides work on
+// different blocks at the same time and nothing is allocated on the way.
+template <typename T>
+struct BlockQueue {
+  // Constructor
+  BlockQueue(size_t slots, size_t block_size)
+  : buffers(slots, std::vector<T>(block_size)), counts(slots) {}
+
+  // Methods
+  size_t block_size() const {
+    return buffers[0].size();
+  }
+
+  // Producer: wait for a free block (nullptr if the queue was cancelled)
+  T* acquire() {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return pushed - released < buffers.size() || cancelled; });
+    return cancelled ? nullptr : buffers[pushed % buffers.size()].data();
+  }
+
+  // Producer: hand over the acquired block holding count values
+  void push(size_t count) {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      counts[pushed % buffers.size()] = count;
+      pushed++;
+    }
+    cv.notify_all();
+  }
+
+  // Producer: no more blocks
+  void finish() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      finished = true;
+    }
+    cv.notify_all();
+  }
+
+  // Consumer: wait for the next block, false when the producer is done
+  bool pop(T*& data, size_t& count) {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return popped < pushed || finished; });
+    if(popped == pushed)
+      return false;
+    data = buffers[popped % buffers.size()].data();
+    count = counts[popped % buffers.size()];
+    popped++;
+    return true;
+  }
+
+  // Consumer: give the popped block back to the producer
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      released++;
+    }
+    cv.notify_all();
+  }
+
+  // Consumer: stop a producer waiting for a free block
+  void cancel() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      cancelled = true;
+    }
+    cv.notify_all();
+  }
+
+  // Attributes
+  private:
+    std::vector<std::vector<T>> buffers;
+    std::vector<size_t> counts;
+    size_t pushed = 0;
+    size_t popped = 0;
+    size_t released = 0;
+    bool finished = false;
+    bool cancelled = false;
+    std::mutex m;
+    std::condition_variable cv;
+};
+
+#endif
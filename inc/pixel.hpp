@@ -0,0 +1,162 @@
+#ifndef PIXEL_H
+#define PIXEL_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "parallel.hpp"
+
+// Pixel kernels on netpbm rasters: rows of samples of D bytes (1, or 2 in
+// big-endian order), RGB interleaved, 1-bit rows packed 8 pixels per byte
+// with the first pixel in the highest bit (1 = black) and padded to whole
+// bytes. Each kernel works on whole rows with fixed-point integer loops the
+// compiler can vectorize; the image drivers split the rows in strips.
+
+// Below this number of pixels the image drivers run on one thread
+constexpr size_t PIXEL_MIN_PARALLEL = 1 << 16;
+
+inline size_t pixel_threads(size_t width, size_t height, size_t threads) {
+  if(width * height < PIXEL_MIN_PARALLEL)
+    return 1;
+  return num_threads(threads);
+}
+
+template <int D>
+inline uint32_t load_sample(const uint8_t* p, size_t i) {
+  if constexpr(D == 1)
+    return p[i];
+  else
+    return (uint32_t)p[2*i] << 8 | p[2*i + 1];
+}
+
+template <int D>
+inline void store_sample(uint8_t* p, size_t i, uint32_t v) {
+  if constexpr(D == 1) {
+    p[i] = v;
+  }
+  else {
+    p[2*i] = v >> 8;
+    p[2*i + 1] = v & 0xFF;
+  }
+}
+
+// ITU-R BT.601 luma with 8-bit weights (77 + 150 + 29 = 256), rounded
+inline uint32_t luma(uint32_t red, uint32_t green, uint32_t blue) {
+  return (77 * red + 150 * green + 29 * blue + 128) >> 8;
+}
+
+template <int D>
+void rgb_to_luma_row(const uint8_t* rgb, uint8_t* gray, size_t n) {
+  for(size_t i=0; i<n; i++) {
+    uint32_t y = luma(load_sample<D>(rgb, 3*i), load_sample<D>(rgb, 3*i + 1), load_sample<D>(rgb, 3*i + 2));
+    store_sample<D>(gray, i, y);
+  }
+}
+
+// Samples below threshold are black. Each output byte is built from 8
+// comparisons without branches.
+template <int D>
+void threshold_pack_row(const uint8_t* gray, size_t n, uint32_t threshold, uint8_t* bits) {
+  size_t full = n / 8;
+  for(size_t k=0; k<full; k++) {
+    uint8_t b = 0;
+    for(size_t j=0; j<8; j++)
+      b |= (uint8_t)(load_sample<D>(gray, 8*k + j) < threshold) << (7 - j);
+    bits[k] = b;
+  }
+  if(n % 8 != 0) {
+    uint8_t b = 0;
+    for(size_t j=0; j<n%8; j++)
+      b |= (uint8_t)(load_sample<D>(gray, 8*full + j) < threshold) << (7 - j);
+    bits[full] = b;
+  }
+}
+
+// Channel ch of a raster of n pixels of channels samples, as values
+template <typename T>
+void raster_to_plane(const uint8_t* raster, size_t n, size_t channels, size_t ch, size_t depth, T* plane) {
+  for(size_t i=0; i<n; i++)
+    plane[i] = (depth == 1) ? load_sample<1>(raster, channels*i + ch) : load_sample<2>(raster, channels*i + ch);
+}
+
+// Values rounded and clipped to [0, max], to channel ch of a raster
+template <typename T>
+void plane_to_raster(const T* plane, size_t n, size_t channels, size_t ch, size_t depth, uint32_t max, uint8_t* raster) {
+  T top = max;
+  for(size_t i=0; i<n; i++) {
+    uint32_t v = std::clamp<T>(plane[i], 0, top) + T(0.5);
+    if(depth == 1)
+      store_sample<1>(raster, channels*i + ch, v);
+    else
+      store_sample<2>(raster, channels*i + ch, v);
+  }
+}
+
+// Grayscale raster (width * height samples) of an RGB raster
+inline void rgb_to_gray(const uint8_t* rgb, uint8_t* gray, size_t width, size_t height, size_t depth, size_t threads = 0) {
+  parallel_for(height, [&](size_t begin, size_t end) {
+    for(size_t r=begin; r<end; r++) {
+      if(depth == 1)
+        rgb_to_luma_row<1>(rgb + 3*r*width, gray + r*width, width);
+      else
+        rgb_to_luma_row<2>(rgb + 6*r*width, gray + 2*r*width, width);
+    }
+  }, pixel_threads(width, height, threads));
+}
+
+// 1-bit raster of a grayscale raster: samples below threshold are black
+inline void binarize(const uint8_t* gray, uint8_t* bits, size_t width, size_t height, size_t depth, uint32_t threshold, size_t threads = 0) {
+  size_t row_bytes = (width + 7) / 8;
+  parallel_for(height, [&](size_t begin, size_t end) {
+    for(size_t r=begin; r<end; r++) {
+      if(depth == 1)
+        threshold_pack_row<1>(gray + r*width, width, threshold, bits + r*row_bytes);
+      else
+        threshold_pack_row<2>(gray + 2*r*width, width, threshold, bits + r*row_bytes);
+    }
+  }, pixel_threads(width, height, threads));
+}
+
+template <int D>
+void dither_rows(const uint8_t* gray, uint8_t* bits, size_t width, size_t height, uint32_t max) {
+  size_t row_bytes = (width + 7) / 8;
+  // Errors of the current and of the next row, with a margin on each side
+  std::vector<int32_t> cur(width + 2, 0);
+  std::vector<int32_t> next(width + 2, 0);
+  int32_t threshold = (max + 1) / 2;
+
+  for(size_t r=0; r<height; r++) {
+    uint8_t* out = bits + r*row_bytes;
+    std::fill(out, out + row_bytes, 0);
+    for(size_t c=0; c<width; c++) {
+      int32_t v = (int32_t)load_sample<D>(gray, r*width + c) + cur[c + 1];
+      int32_t e = v;
+      if(v < threshold) {
+        out[c / 8] |= 0b10000000 >> (c % 8);
+      }
+      else {
+        e = v - (int32_t)max;
+      }
+      cur[c + 2]  += e * 7 / 16;
+      next[c]     += e * 3 / 16;
+      next[c + 1] += e * 5 / 16;
+      next[c + 2] += e / 16;
+    }
+    std::swap(cur, next);
+    std::fill(next.begin(), next.end(), 0);
+  }
+}
+
+// 1-bit raster with Floyd-Steinberg error diffusion. The error of each
+// pixel flows to the next row, so the rows are processed in order on one
+// thread.
+inline void dither(const uint8_t* gray, uint8_t* bits, size_t width, size_t height, size_t depth, uint32_t max) {
+  if(depth == 1)
+    dither_rows<1>(gray, bits, width, height, max);
+  else
+    dither_rows<2>(gray, bits, width, height, max);
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef PLAIN_H
+#define PLAIN_H
+
+#include <cstdio>
+#include <cstdint>
+#include <charconv>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "parallel.hpp"
+#include "pixel.hpp"
+
+// Rasters of plain netpbm images (P1, P2, P3): ASCII decimal samples
+// separated by whitespace, with comments from '#' to the end of the line.
+// P1 pixels are single digits, which may be packed together. To parse in
+// parallel, the text is cut in chunks after line ends, so that no chunk
+// starts inside a field or a comment: the fields of each chunk are counted,
+// then each chunk is parsed from its first sample index with from_chars.
+
+// No line of a plain file written here is longer than this
+constexpr size_t PLAIN_LINE_LENGTH = 70;
+
+inline bool plain_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Call f(begin, end) on each field of the text, skipping the comments
+template <typename F>
+void plain_fields(const char* p, const char* end, F f) {
+  while(p < end) {
+    if(*p == '#') {
+      while(p < end && *p != '\n')
+        p++;
+    }
+    else if(plain_space(*p)) {
+      p++;
+    }
+    else {
+      const char* begin = p;
+      while(p < end && !plain_space(*p) && *p != '#')
+        p++;
+      f(begin, p);
+    }
+  }
+}
+
+// Bounds of count chunks of the text (count + 1 pointers), cut after a line
+// end. Without line ends, the first chunk takes all the text.
+inline std::vector<const char*> plain_chunks(const char* begin, const char* end, size_t count) {
+  std::vector<const char*> cuts = { begin };
+  size_t step = (end - begin) / count;
+  for(size_t k=1; k<count; k++) {
+    const char* p = std::max(cuts.back(), begin + k*step);
+    while(p < end && *p != '\n')
+      p++;
+    cuts.push_back(p < end ? p + 1 : end);
+  }
+  cuts.push_back(end);
+  return cuts;
+}
+
+// Index of the first field of each chunk, and the total number of fields.
+// size_of_field gives the number of samples in a field.
+template <typename S>
+std::vector<size_t> plain_first_index(const std::vector<const char*>& cuts, S size_of_field, size_t threads) {
+  size_t chunks = cuts.size() - 1;
+  std::vector<size_t> first(chunks + 1, 0);
+  parallel_for(chunks, [&](size_t begin, size_t end) {
+    for(size_t k=begin; k<end; k++)
+      plain_fields(cuts[k], cuts[k + 1], [&](const char* b, const char* e) {
+        first[k + 1] += size_of_field(b, e);
+      });
+  }, threads);
+  for(size_t k=0; k<chunks; k++)
+    first[k + 1] += first[k];
+  return first;
+}
+
+template <int D>
+bool parse_plain_chunk(const char* begin, const char* end, uint8_t* raster, size_t i, size_t n, uint32_t max) {
+  bool ok = true;
+  plain_fields(begin, end, [&](const char* b, const char* e) {
+    if(i >= n)
+      return;
+    uint32_t v = 0;
+    auto [ptr, ec] = std::from_chars(b, e, v);
+    if(ec != std::errc() || ptr != e || v > max)
+      ok = false;
+    store_sample<D>(raster, i++, v);
+  });
+  return ok;
+}
+
+// n samples of depth bytes (P2, P3), each at most max
+inline void parse_plain_samples(const char* begin, const char* end, uint8_t* raster, size_t n, size_t depth, uint32_t max, size_t threads = 0) {
+  size_t T = pixel_threads(n, 1, threads);
+  std::vector<const char*> cuts = plain_chunks(begin, end, T);
+  std::vector<size_t> first = plain_first_index(cuts, [](const char*, const char*) { return 1; }, T);
+  if(first.back() < n) {
+    std::cout << "The plain raster has " << first.back() << " samples instead of " << n << "." << std::endl;
+    exit(1);
+  }
+
+  std::vector<uint8_t> ok(T);
+  parallel_for(T, [&](size_t b, size_t e) {
+    for(size_t k=b; k<e; k++) {
+      if(depth == 1)
+        ok[k] = parse_plain_chunk<1>(cuts[k], cuts[k + 1], raster, first[k], n, max);
+      else
+        ok[k] = parse_plain_chunk<2>(cuts[k], cuts[k + 1], raster, first[k], n, max);
+    }
+  }, T);
+  if(std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+    std::cout << "Error in the plain raster: samples must be integers up to " << max << "." << std::endl;
+    exit(1);
+  }
+}
+
+// n P1 pixels, one byte each: 0 for black ('1'), 1 for white ('0'), so
+// that binarize() with a threshold of 1 packs them
+inline void parse_plain_bits(const char* begin, const char* end, uint8_t* pixels, size_t n, size_t threads = 0) {
+  size_t T = pixel_threads(n, 1, threads);
+  std::vector<const char*> cuts = plain_chunks(begin, end, T);
+  std::vector<size_t> first = plain_first_index(cuts, [](const char* b, const char* e) { return e - b; }, T);
+  if(first.back() < n) {
+    std::cout << "The plain raster has " << first.back() << " pixels instead of " << n << "." << std::endl;
+    exit(1);
+  }
+
+  std::vector<uint8_t> ok(T, 1);
+  parallel_for(T, [&](size_t b, size_t e) {
+    for(size_t k=b; k<e; k++) {
+      size_t i = first[k];
+      plain_fields(cuts[k], cuts[k + 1], [&](const char* p, const char* q) {
+        for(; p < q && i < n; p++, i++) {
+          if(*p != '0' && *p != '1')
+            ok[k] = 0;
+          pixels[i] = '1' - *p;
+        }
+      });
+    }
+  }, T);
+  if(std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+    std::cout << "Error in the plain raster: pixels must be 0 or 1." << std::endl;
+    exit(1);
+  }
+}
+
+// Text of rows [begin, end) of a binary raster: one line per row, broken
+// before PLAIN_LINE_LENGTH characters
+template <int D>
+void format_plain_rows(const uint8_t* raster, char magic, size_t width, size_t begin, size_t end, std::string& out) {
+  if(magic == '1') {
+    size_t row_bytes = (width + 7) / 8;
+    for(size_t r=begin; r<end; r++) {
+      const uint8_t* row = raster + r*row_bytes;
+      for(size_t c=0; c<width; c++) {
+        if(c > 0 && c % PLAIN_LINE_LENGTH == 0)
+          out += '\n';
+        out += (char)('0' + ((row[c / 8] >> (7 - c % 8)) & 1));
+      }
+      out += '\n';
+    }
+    return;
+  }
+
+  size_t samples = (magic == '3') ? 3 * width : width;
+  char field[8];
+  for(size_t r=begin; r<end; r++) {
+    const uint8_t* row = raster + r*samples*D;
+    size_t line = 0;
+    for(size_t i=0; i<samples; i++) {
+      char* last = std::to_chars(field, field + sizeof(field), load_sample<D>(row, i)).ptr;
+      size_t len = last - field;
+      if(line > 0 && line + 1 + len > PLAIN_LINE_LENGTH) {
+        out += '\n';
+        line = 0;
+      }
+      else if(line > 0) {
+        out += ' ';
+        line++;
+      }
+      out.append(field, len);
+      line += len;
+    }
+    out += '\n';
+  }
+}
+
+// Write the raster of a binary image (P4, P5 or P6 layout) as the text of
+// the plain format magic ('1', '2' or '3'). Blocks of rows are formatted
+// in parallel, then written in order.
+inline void write_plain_raster(std::ostream& fs, const uint8_t* raster, char magic, size_t width, size_t height, size_t depth, size_t threads = 0) {
+  size_t T = std::min(pixel_threads(width, height, threads), height);
+  std::vector<std::string> blocks(T);
+  parallel_for(T, [&](size_t b, size_t e) {
+    for(size_t k=b; k<e; k++) {
+      size_t first = height * k / T;
+      size_t last = height * (k + 1) / T;
+      // Longest sample and a space per sample, one line end per row
+      blocks[k].reserve((last - first) * (width * (magic == '3' ? 3 : 1) * (depth == 1 ? 4 : 6) + 1));
+      if(depth == 1)
+        format_plain_rows<1>(raster, magic, width, first, last, blocks[k]);
+      else
+        format_plain_rows<2>(raster, magic, width, first, last, blocks[k]);
+    }
+  }, T);
+  for(auto& b : blocks)
+    fs.write(b.data(), b.size());
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
 #include "complex.hpp"
 
 template <typename T>
@@ -12,3 +15,5 @@ Cpx<T> complex_rand() {
   Cpx<T> c = { real_rand<T>(), real_rand<T>() };
   return c;
 }
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef RANS_H
+#define RANS_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "histogram.hpp"
+#include "huffman.hpp" // load_le64 and store_le64
+
+// Range asymmetric numeral system (rANS) coding of bytes with a static
+// table of frequencies that sum to M = 2^RANS_PROB_BITS. A symbol of
+// frequency f costs log2(M / f) bits, with no rounding to whole bits as in
+// a Huffman code.
+//
+// The state x is 32-bit and kept in [L, 2^16 L) with L = 2^15: encoding a
+// symbol first writes the 16 low bits of x if it would leave the range,
+// decoding reads them back, so at most one 16-bit word is moved per
+// symbol, and x stays below 2^31 so that the division by the frequency is
+// a multiplication by its reciprocal. RANS_LANES states are interleaved (symbol i uses state
+// i % RANS_LANES) and share one stream of words: the lanes of a group are
+// independent, so the decoder steps of a group are the same arithmetic on
+// RANS_LANES values.
+//
+// The encoder runs from the last symbol to the first and writes the words
+// from the end of the buffer, so that the decoder reads them forward.
+
+constexpr size_t RANS_PROB_BITS = 12;
+constexpr size_t RANS_LANES = 8;
+constexpr uint32_t RANS_L = (uint32_t)1 << 15;
+
+// Encoding and decoding tables of a set of normalized frequencies
+struct RansTable {
+  // Constructor
+  RansTable(const uint32_t* freq) {
+    const uint32_t M = (uint32_t)1 << RANS_PROB_BITS;
+    uint32_t c = 0;
+    for(size_t s=0; s<256; s++) {
+      this->freq[s] = freq[s];
+      cum[s] = c;
+      // Largest state before encoding s that stays below 2^16 L once encoded
+      x_max[s] = ((uint64_t)(RANS_L >> RANS_PROB_BITS) << 16) * freq[s];
+      c += freq[s];
+
+      // Reciprocal of freq[s], exact for x < 2^31 (with f = 1, x / f is
+      // x * (2^32 - 1) >> 32 = x - 1, the bias adds the 1 back)
+      cmpl[s] = M - freq[s];
+      if(freq[s] < 2) {
+        rcp[s] = ~0u;
+        rcp_shift[s] = 0;
+        bias[s] = cum[s] + M - 1;
+      }
+      else {
+        uint32_t shift = 0;
+        while(freq[s] > ((uint32_t)1 << shift))
+          shift++;
+        rcp[s] = (((uint64_t)1 << (shift + 31)) + freq[s] - 1) / freq[s];
+        rcp_shift[s] = shift - 1;
+        bias[s] = cum[s];
+      }
+    }
+    if(c != M) {
+      std::cout << "The rANS frequencies sum to " << c << " instead of " << M << "." << std::endl;
+      exit(1);
+    }
+
+    // Symbol, frequency - 1 and offset in its range, for each slot
+    slots.resize(M);
+    for(size_t s=0; s<256; s++)
+      for(uint32_t k=0; k<freq[s]; k++)
+        slots[cum[s] + k] = (uint32_t)s << 24 | (freq[s] - 1) << 12 | k;
+  }
+
+  // Attributes
+  uint32_t freq[256];
+  uint32_t cum[256];
+  uint64_t x_max[256];
+  uint32_t rcp[256];
+  uint32_t rcp_shift[256];
+  uint32_t bias[256];
+  uint32_t cmpl[256];
+  std::vector<uint32_t> slots;
+};
+
+// Encode n bytes, words are written before end. Returns the first word.
+inline uint16_t* rans_encode(const uint8_t* data, size_t n, const RansTable& t, uint16_t* end) {
+  uint32_t x[RANS_LANES];
+  for(size_t j=0; j<RANS_LANES; j++)
+    x[j] = RANS_L;
+
+  uint16_t* p = end;
+  for(size_t i=n; i-->0;) {
+    uint32_t& xj = x[i % RANS_LANES];
+    uint8_t s = data[i];
+    // The word is always stored, and kept if the state is too large (the
+    // final states are stored below, so p - 1 is in the buffer)
+    uint32_t renorm = xj >= t.x_max[s];
+    p[-1] = xj & 0xFFFF;
+    p -= renorm;
+    xj >>= 16 * renorm;
+    // x / f by a multiplication: x + cum + (x / f) (M - f) is
+    // (x / f) M + x % f + cum
+    uint32_t q = (uint32_t)(((uint64_t)xj * t.rcp[s]) >> 32) >> t.rcp_shift[s];
+    xj += t.bias[s] + q * t.cmpl[s];
+  }
+
+  // Final states, high word first
+  for(size_t j=RANS_LANES; j-->0;) {
+    *--p = x[j] & 0xFFFF;
+    *--p = x[j] >> 16;
+  }
+  return p;
+}
+
+// Decode n bytes from the words in [p, end). Exits if the words run out or
+// the states do not end where the encoder started.
+inline void rans_decode(const uint16_t* p, const uint16_t* end, const RansTable& t, uint8_t* out, size_t n) {
+  const uint32_t mask = ((uint32_t)1 << RANS_PROB_BITS) - 1;
+  // Byte stores could alias the table, which would then be reloaded
+  const uint32_t* slots = t.slots.data();
+  if(end - p < (ptrdiff_t)(2 * RANS_LANES)) {
+    std::cout << "The rANS data is truncated." << std::endl;
+    exit(1);
+  }
+  uint32_t x[RANS_LANES];
+  for(size_t j=0; j<RANS_LANES; j++) {
+    x[j] = (uint32_t)p[0] << 16 | p[1];
+    p += 2;
+  }
+
+  size_t i = 0;
+  // Groups of lanes, while a group cannot run out of words
+  for(; i+RANS_LANES<=n && end-p>=(ptrdiff_t)RANS_LANES; i+=RANS_LANES) {
+    for(size_t j=0; j<RANS_LANES; j++) {
+      uint32_t e = slots[x[j] & mask];
+      out[i + j] = e >> 24;
+      uint32_t y = ((e >> 12 & mask) + 1) * (x[j] >> RANS_PROB_BITS) + (e & mask);
+      // Without branch: each lane reads at most one word, so *p is in the data
+      uint32_t renorm = y < RANS_L;
+      x[j] = (y << (16 * renorm)) | (*p & (0 - renorm));
+      p += renorm;
+    }
+  }
+  for(; i<n; i++) {
+    uint32_t& xj = x[i % RANS_LANES];
+    uint32_t e = slots[xj & mask];
+    out[i] = e >> 24;
+    xj = ((e >> 12 & mask) + 1) * (xj >> RANS_PROB_BITS) + (e & mask);
+    if(xj < RANS_L) {
+      if(p == end) {
+        std::cout << "The rANS data is truncated." << std::endl;
+        exit(1);
+      }
+      xj = xj << 16 | *p++;
+    }
+  }
+
+  for(size_t j=0; j<RANS_LANES; j++) {
+    if(x[j] != RANS_L) {
+      std::cout << "The rANS data is corrupt." << std::endl;
+      exit(1);
+    }
+  }
+}
+
+// Compressed bytes: the input size on 8 bytes, the 256 normalized
+// frequencies on 2 bytes each, then the 16-bit words
+inline std::vector<uint8_t> rans_compress(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> out(8);
+  store_le64(out.data(), size);
+  if(size == 0)
+    return out;
+
+  uint64_t freq[256];
+  uint32_t norm[256];
+  byte_histogram(data, size, freq);
+  normalize_frequencies(freq, 256, RANS_PROB_BITS, norm);
+  RansTable table(norm);
+
+  // At most one word per symbol, and the final states
+  std::vector<uint16_t> words(size + 2 * RANS_LANES);
+  uint16_t* end = words.data() + words.size();
+  uint16_t* first = rans_encode(data, size, table, end);
+
+  size_t header = 8 + 2 * 256;
+  out.resize(header + 2 * (end - first));
+  for(size_t s=0; s<256; s++) {
+    out[8 + 2*s] = norm[s] & 0xFF;
+    out[8 + 2*s + 1] = norm[s] >> 8;
+  }
+  uint8_t* o = out.data() + header;
+  if constexpr(std::endian::native == std::endian::little) {
+    memcpy(o, first, 2 * (end - first));
+  }
+  else {
+    for(const uint16_t* w=first; w<end; w++) {
+      *o++ = *w & 0xFF;
+      *o++ = *w >> 8;
+    }
+  }
+  return out;
+}
+
+inline std::vector<uint8_t> rans_decompress(const uint8_t* data, size_t size) {
+  if(size < 8) {
+    std::cout << "The rANS data is truncated." << std::endl;
+    exit(1);
+  }
+  uint64_t n = load_le64(data);
+  std::vector<uint8_t> out;
+  if(n == 0)
+    return out;
+  size_t header = 8 + 2 * 256;
+  if(size < header || (size - header) % 2 != 0) {
+    std::cout << "The rANS data is truncated." << std::endl;
+    exit(1);
+  }
+
+  uint32_t norm[256];
+  for(size_t s=0; s<256; s++)
+    norm[s] = data[8 + 2*s] | (uint32_t)data[8 + 2*s + 1] << 8;
+  RansTable table(norm);
+
+  std::vector<uint16_t> words((size - header) / 2);
+  if constexpr(std::endian::native == std::endian::little) {
+    memcpy(words.data(), data + header, 2 * words.size());
+  }
+  else {
+    for(size_t k=0; k<words.size(); k++)
+      words[k] = data[header + 2*k] | (uint16_t)data[header + 2*k + 1] << 8;
+  }
+
+  out.resize(n);
+  rans_decode(words.data(), words.data() + words.size(), table, out.data(), n);
+  return out;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "constants.hpp"
+#include "parallel.hpp"
+#include "pixel.hpp"
+#include "netpbm.hpp"
+
+// Separable polyphase resampling of netpbm rasters (1 or 3 interleaved
+// samples per pixel, of 1 or 2 bytes). Each output position has its own
+// phase of the filter: a filter bank holds, for every output column (or
+// row), the first input column and a fixed number of weights. The banks
+// depend only on the sizes and the filter, so they are computed once and
+// used for any number of images of the same size.
+//
+// The horizontal pass filters each input row into a float row of the
+// output width, the vertical pass combines whole float rows into an
+// output row. Both are plain loops over contiguous floats that the
+// compiler can vectorize, and both are split in strips of rows across
+// threads. When downscaling, the filters are stretched by the scale factor
+// so that they also act as anti-aliasing filters.
+
+enum class ResampleFilter { box, bicubic, lanczos3 };
+
+// Half width of the filter at scale 1
+inline double filter_support(ResampleFilter filter) {
+  switch(filter) {
+    case ResampleFilter::box:      return 0.5;
+    case ResampleFilter::bicubic:  return 2;
+    case ResampleFilter::lanczos3: return 3;
+  }
+  return 0;
+}
+
+inline double filter_value(ResampleFilter filter, double x) {
+  x = std::abs(x);
+  switch(filter) {
+    case ResampleFilter::box:
+      return (x < 0.5) ? 1 : 0;
+    case ResampleFilter::bicubic: {
+      // Keys cubic with a = -0.5 (Catmull-Rom)
+      if(x < 1)
+        return (1.5 * x - 2.5) * x * x + 1;
+      if(x < 2)
+        return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+      return 0;
+    }
+    case ResampleFilter::lanczos3: {
+      if(x < 1e-9)
+        return 1;
+      if(x >= 3)
+        return 0;
+      return 3 * std::sin(PI * x) * std::sin(PI * x / 3) / (PI * PI * x * x);
+    }
+  }
+  return 0;
+}
+
+// Weights of out positions from in positions. Taps falling outside the
+// input are folded on the border samples, so that every window lies
+// inside the input and the border pixels are repeated.
+struct FilterBank {
+  // Constructor
+  FilterBank() = default;
+
+  FilterBank(size_t in, size_t out, ResampleFilter filter) {
+    if(in == 0 || out == 0) {
+      std::cout << "Cannot resample an empty image." << std::endl;
+      exit(1);
+    }
+    double scale = (double)in / out;
+    double stretch = std::max(scale, 1.0);
+    double support = filter_support(filter) * stretch;
+    taps = std::min(in, (size_t)std::ceil(2 * support) + 1);
+    first.resize(out);
+    weights.assign(out * taps, 0);
+
+    std::vector<double> w(taps);
+    for(size_t i=0; i<out; i++) {
+      // Input position of the center of output sample i
+      double center = (i + 0.5) * scale - 0.5;
+      long lo = std::ceil(center - support);
+      long hi = std::floor(center + support);
+      long f = std::clamp<long>(lo, 0, in - taps);
+      std::fill(w.begin(), w.end(), 0);
+      double sum = 0;
+      for(long j=lo; j<=hi; j++) {
+        double v = filter_value(filter, (j - center) / stretch);
+        w[std::clamp<long>(j, 0, in - 1) - f] += v;
+        sum += v;
+      }
+      // Nearest sample if no tap has a weight
+      if(sum == 0) {
+        w[std::clamp<long>(std::lround(center), 0, in - 1) - f] = 1;
+        sum = 1;
+      }
+      first[i] = f;
+      for(size_t t=0; t<taps; t++)
+        weights[i*taps + t] = w[t] / sum;
+    }
+  }
+
+  // Attributes
+  size_t taps = 0;
+  std::vector<uint32_t> first;
+  std::vector<float> weights;
+};
+
+// Horizontal pass: one raster row to a float row of out_width pixels
+template <int D>
+void resample_row(const uint8_t* in, float* out, const FilterBank& bank, size_t out_width, size_t channels) {
+  size_t taps = bank.taps;
+  for(size_t x=0; x<out_width; x++) {
+    const float* w = bank.weights.data() + x*taps;
+    size_t s0 = bank.first[x] * channels;
+    for(size_t c=0; c<channels; c++) {
+      float acc = 0;
+      for(size_t t=0; t<taps; t++)
+        acc += w[t] * load_sample<D>(in, s0 + t*channels + c);
+      out[x*channels + c] = acc;
+    }
+  }
+}
+
+// Vertical pass: weighted sum of taps float rows, rounded and clipped to [0, max]
+template <int D>
+void resample_column(const float* rows, size_t stride, const float* w, size_t taps, float* acc, size_t n, uint32_t max, uint8_t* out) {
+  std::fill(acc, acc + n, 0);
+  for(size_t t=0; t<taps; t++) {
+    const float* row = rows + t*stride;
+    float k = w[t];
+    for(size_t i=0; i<n; i++)
+      acc[i] += k * row[i];
+  }
+  float top = max;
+  for(size_t i=0; i<n; i++)
+    store_sample<D>(out, i, (uint32_t)(std::clamp(acc[i], 0.0f, top) + 0.5f));
+}
+
+// Resizer of rasters of a given size, with its filter banks
+struct Resampler {
+  // Constructor
+  Resampler(size_t in_width, size_t in_height, size_t out_width, size_t out_height, ResampleFilter filter = ResampleFilter::lanczos3)
+  : in_width { in_width }, in_height { in_height }, out_width { out_width }, out_height { out_height },
+    horizontal { in_width, out_width, filter }, vertical { in_height, out_height, filter } {}
+
+  // Methods
+  // channels samples per pixel, of depth bytes, at most max
+  void run(const uint8_t* in, uint8_t* out, size_t channels, size_t depth, uint32_t max, size_t threads = 0) const {
+    size_t n = out_width * channels;
+    std::vector<float> tmp(in_height * n);
+
+    // Only the input rows used by the vertical filter are filtered horizontally
+    size_t row_begin = vertical.first.front();
+    size_t row_end = vertical.first.back() + vertical.taps;
+    size_t in_row = in_width * channels * depth;
+    parallel_for(row_end - row_begin, [&](size_t begin, size_t end) {
+      for(size_t r=row_begin+begin; r<row_begin+end; r++) {
+        if(depth == 1)
+          resample_row<1>(in + r*in_row, tmp.data() + r*n, horizontal, out_width, channels);
+        else
+          resample_row<2>(in + r*in_row, tmp.data() + r*n, horizontal, out_width, channels);
+      }
+    }, pixel_threads(in_width, row_end - row_begin, threads));
+
+    parallel_for(out_height, [&](size_t begin, size_t end) {
+      std::vector<float> acc(n);
+      for(size_t y=begin; y<end; y++) {
+        const float* rows = tmp.data() + vertical.first[y] * n;
+        const float* w = vertical.weights.data() + y*vertical.taps;
+        if(depth == 1)
+          resample_column<1>(rows, n, w, vertical.taps, acc.data(), n, max, out + y*n);
+        else
+          resample_column<2>(rows, n, w, vertical.taps, acc.data(), n, max, out + 2*y*n);
+      }
+    }, pixel_threads(out_width, out_height, threads));
+  }
+
+  // Attributes
+  private:
+    size_t in_width, in_height, out_width, out_height;
+    FilterBank horizontal;
+    FilterBank vertical;
+};
+
+// Image of width x height pixels from a grayscale or RGB image
+inline netpbm resize(const netpbm& img, size_t width, size_t height, ResampleFilter filter = ResampleFilter::lanczos3, size_t threads = 0) {
+  if(img.is_baw()) {
+    std::cout << "Only grayscale and RGB images can be resampled." << std::endl;
+    exit(1);
+  }
+  size_t channels = img.is_rgb() ? 3 : 1;
+  std::vector<uint8_t> out(width * height * channels * img.get_depth());
+  Resampler resampler(img.get_width(), img.get_height(), width, height, filter);
+  resampler.run(img.data(), out.data(), channels, img.get_depth(), img.get_max(), threads);
+  return netpbm(img.is_rgb() ? "P6" : "P5", width, height, img.get_max(), out.data());
+}
+
+// Pyramid of levels images, each half the size of the previous one (rounded
+// up) down to 1 x 1. Level 0 is computed from the image and every other
+// level from the one before it, so the whole pyramid costs about a third
+// more than its first level. The levels are built one after the other,
+// each split across the threads: a row of a level needs several rows of
+// the previous one on both sides, so strips of rows cannot be carried
+// through all the levels without recomputing their borders at each level.
+inline std::vector<netpbm> build_pyramid(const netpbm& img, size_t levels, ResampleFilter filter = ResampleFilter::box, size_t threads = 0) {
+  std::vector<netpbm> pyramid;
+  pyramid.reserve(levels);
+  const netpbm* src = &img;
+  for(size_t l=0; l<levels; l++) {
+    size_t width = src->get_width();
+    size_t height = src->get_height();
+    if(width == 1 && height == 1)
+      break;
+    pyramid.push_back(resize(*src, (width + 1) / 2, (height + 1) / 2, filter, threads));
+    src = &pyramid.back();
+  }
+  return pyramid;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SEPARABLE_H
+#define SEPARABLE_H
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "parallel.hpp"
+#include "matrix.hpp"
+
+// Separable 2D transforms on a contiguous strided buffer:
+//   element (r, c) is data[r*stride + c], with stride >= cols.
+// A 1D transform is a callable op(T* line, size_t n, T* scratch) working in place
+// on n contiguous elements, with a scratch area of n elements it can use freely.
+
+// Tile size of the blocked transposes and width of the column strips
+constexpr size_t SEPARABLE_BLOCK = 16;
+
+// Below this number of elements the 2D transforms run on one thread
+constexpr size_t SEPARABLE_MIN_PARALLEL = 1 << 14;
+
+// dst (cols x rows) = src^T (rows x cols), tile by tile to stay in cache
+template <typename T>
+void transpose_blocked(const T* src, size_t src_stride, T* dst, size_t dst_stride, size_t rows, size_t cols) {
+  const size_t B = SEPARABLE_BLOCK;
+  for(size_t r0=0; r0<rows; r0+=B) {
+    size_t r1 = std::min(r0 + B, rows);
+    for(size_t c0=0; c0<cols; c0+=B) {
+      size_t c1 = std::min(c0 + B, cols);
+      for(size_t r=r0; r<r1; r++) {
+        for(size_t c=c0; c<c1; c++) {
+          dst[c*dst_stride + r] = src[r*src_stride + c];
+        }
+      }
+    }
+  }
+}
+
+inline size_t separable_threads(size_t rows, size_t cols, size_t threads) {
+  if(rows * cols < SEPARABLE_MIN_PARALLEL)
+    return 1;
+  return num_threads(threads);
+}
+
+// Apply op to every row
+template <typename T, typename Op>
+void transform_rows(T* data, size_t rows, size_t cols, size_t stride, Op op, size_t threads = 0) {
+  parallel_for(rows, [&](size_t begin, size_t end) {
+    std::vector<T> scratch(cols);
+    for(size_t r=begin; r<end; r++) {
+      op(data + r*stride, cols, scratch.data());
+    }
+  }, separable_threads(rows, cols, threads));
+}
+
+// Apply op to every column.
+// Strips of SEPARABLE_BLOCK columns are transposed into a per-thread buffer,
+// transformed as contiguous lines and transposed back.
+template <typename T, typename Op>
+void transform_cols(T* data, size_t rows, size_t cols, size_t stride, Op op, size_t threads = 0) {
+  const size_t B = SEPARABLE_BLOCK;
+  size_t strips = (cols + B - 1) / B;
+
+  parallel_for(strips, [&](size_t begin, size_t end) {
+    std::vector<T> strip(B * rows);
+    std::vector<T> scratch(rows);
+    for(size_t s=begin; s<end; s++) {
+      size_t c0 = s * B;
+      size_t w = std::min(B, cols - c0);
+
+      // Gather w columns as w contiguous lines of length rows
+      transpose_blocked(data + c0, stride, strip.data(), rows, rows, w);
+
+      for(size_t j=0; j<w; j++) {
+        op(strip.data() + j*rows, rows, scratch.data());
+      }
+
+      // Scatter them back
+      transpose_blocked(strip.data(), rows, data + c0, stride, w, rows);
+    }
+  }, separable_threads(rows, cols, threads));
+}
+
+// Row pass followed by column pass
+template <typename T, typename RowOp, typename ColOp>
+void separable_2d(T* data, size_t rows, size_t cols, size_t stride, RowOp row_op, ColOp col_op, size_t threads = 0) {
+  transform_rows(data, rows, cols, stride, row_op, threads);
+  transform_cols(data, rows, cols, stride, col_op, threads);
+}
+
+// Same 1D transform on both dimensions
+template <typename T, typename Op>
+void separable_2d(T* data, size_t rows, size_t cols, size_t stride, Op op, size_t threads = 0) {
+  separable_2d(data, rows, cols, stride, op, op, threads);
+}
+
+// Same 1D transform on both dimensions of a view with contiguous rows or columns.
+// A transposed view is transformed on its buffer: transposing commutes with the 2D transform.
+template <typename T, typename Op>
+void separable_2d(MatrixView<T> v, Op op, size_t threads = 0) {
+  if(v.col_stride() == 1) {
+    separable_2d(v.data(), v.r(), v.c(), v.row_stride(), op, threads);
+  }
+  else if(v.row_stride() == 1) {
+    separable_2d(v.data(), v.c(), v.r(), v.col_stride(), op, threads);
+  }
+  else {
+    std::cout << "2D transforms need a view with contiguous rows or columns." << std::endl;
+    exit(1);
+  }
+}
+
+#endif
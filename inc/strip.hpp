@@ -0,0 +1,309 @@
+#ifndef STRIP_H
+#define STRIP_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "netpbm.hpp"
+#include "pixel.hpp"
+
+// Streaming of binary netpbm images (P4, P5, P6) in strips of rows through
+// a chain of stages, so that only a few strips are in memory at any time.
+
+// Layout of a binary raster
+struct RasterFormat {
+  std::string magic_number;
+  size_t width = 0;
+  size_t height = 0;
+  int max = 1;
+
+  // Bytes per sample
+  size_t depth() const {
+    return (max > 255) ? 2 : 1;
+  }
+
+  size_t row_bytes() const {
+    if(magic_number == "P4")
+      return (width + 7) / 8;
+    if(magic_number == "P6")
+      return 3 * width * depth();
+    return width * depth();
+  }
+};
+
+// Rows of a binary netpbm file, read strip by strip
+struct NetpbmStripReader {
+  // Constructor
+  NetpbmStripReader(const std::string& filename) {
+    fs.open(filename, std::ios::binary);
+    if(!fs.is_open()) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+
+    // The header is in the first bytes (unless it has very long comments)
+    std::vector<unsigned char> head(4096);
+    fs.read((char*)head.data(), head.size());
+    head.resize(fs.gcount());
+    fs.clear();
+
+    NetpbmTokenizer tok(head.data(), head.size());
+    int width, height;
+    read_netpbm_header(tok, filename, format.magic_number, width, height, format.max);
+    if(format.magic_number[1] < '4') {
+      std::cout << "Only binary netpbm images (P4, P5, P6) can be streamed." << std::endl;
+      exit(1);
+    }
+    format.width = width;
+    format.height = height;
+    fs.seekg(tok.raster_offset(head.data()));
+  }
+
+  // Methods
+  const RasterFormat& get_format() const {
+    return format;
+  }
+
+  // Read up to count rows, returns the number of rows read
+  size_t read(uint8_t* rows, size_t count) {
+    count = std::min(count, format.height - row);
+    fs.read((char*)rows, count * format.row_bytes());
+    size_t got = fs.gcount() / format.row_bytes();
+    if(got < count) {
+      std::cout << "The image is truncated." << std::endl;
+      exit(1);
+    }
+    row += got;
+    return got;
+  }
+
+  // Attributes
+  private:
+    std::ifstream fs;
+    RasterFormat format;
+    size_t row = 0;
+};
+
+// Rows of a binary netpbm file, written strip by strip
+struct NetpbmStripWriter {
+  // Constructor
+  NetpbmStripWriter(const std::string& filename, const RasterFormat& format)
+  : format { format } {
+    fs.open(filename, std::ios::binary);
+    if(!fs.is_open()) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+    std::string header = netpbm_header(format.magic_number, format.width, format.height, format.magic_number == "P4" ? 0 : format.max);
+    fs.write(header.data(), header.size());
+  }
+
+  // Methods
+  void write(const uint8_t* rows, size_t count) {
+    fs.write((const char*)rows, count * format.row_bytes());
+  }
+
+  // Attributes
+  private:
+    std::ofstream fs;
+    RasterFormat format;
+};
+
+// Stage of a strip pipeline. A stage can hold back a few rows (e.g. a
+// filter needing the next row); they are returned by flush() at the end.
+struct StripStage {
+  // Destructor
+  virtual ~StripStage() = default;
+
+  // Methods
+  // Format of the output for the given input (called once, before the rows)
+  virtual RasterFormat setup(const RasterFormat& in) = 0;
+
+  // Convert count input rows, returns the number of rows written to out (at most count)
+  virtual size_t process(const uint8_t* in, size_t count, uint8_t* out) = 0;
+
+  // Rows still held at the end of the image (at most one strip)
+  virtual size_t flush(uint8_t*) {
+    return 0;
+  }
+};
+
+// P6 to P5, same depth
+struct GrayscaleStage : StripStage {
+  GrayscaleStage(size_t threads = 0)
+  : threads { threads } {}
+
+  RasterFormat setup(const RasterFormat& in) override {
+    if(in.magic_number != "P6") {
+      std::cout << "The grayscale stage needs an RGB image." << std::endl;
+      exit(1);
+    }
+    format = in;
+    RasterFormat out = in;
+    out.magic_number = "P5";
+    return out;
+  }
+
+  size_t process(const uint8_t* in, size_t count, uint8_t* out) override {
+    rgb_to_gray(in, out, format.width, count, format.depth(), threads);
+    return count;
+  }
+
+  private:
+    RasterFormat format;
+    size_t threads;
+};
+
+// P5 to P4: samples below the threshold (default: half the maximum) are black
+struct ThresholdStage : StripStage {
+  ThresholdStage(int threshold = -1, size_t threads = 0)
+  : threshold { threshold }, threads { threads } {}
+
+  RasterFormat setup(const RasterFormat& in) override {
+    if(in.magic_number != "P5") {
+      std::cout << "The threshold stage needs a grayscale image." << std::endl;
+      exit(1);
+    }
+    format = in;
+    if(threshold < 0)
+      threshold = (in.max + 1) / 2;
+    RasterFormat out = in;
+    out.magic_number = "P4";
+    out.max = 1;
+    return out;
+  }
+
+  size_t process(const uint8_t* in, size_t count, uint8_t* out) override {
+    binarize(in, out, format.width, count, format.depth(), threshold, threads);
+    return count;
+  }
+
+  private:
+    RasterFormat format;
+    int threshold;
+    size_t threads;
+};
+
+// 3x3 mean of a P5 image, with the border pixels repeated outside.
+// Output row r needs input row r+1, so the stage holds one row back.
+struct BoxFilterStage : StripStage {
+  RasterFormat setup(const RasterFormat& in) override {
+    if(in.magic_number != "P5") {
+      std::cout << "The box filter stage needs a grayscale image." << std::endl;
+      exit(1);
+    }
+    format = in;
+    above.resize(format.row_bytes());
+    center.resize(format.row_bytes());
+    sums.resize(format.width);
+    return in;
+  }
+
+  size_t process(const uint8_t* in, size_t count, uint8_t* out) override {
+    size_t rb = format.row_bytes();
+    size_t n = 0;
+    for(size_t r=0; r<count; r++) {
+      const uint8_t* below = in + r*rb;
+      if(seen == 0) {
+        std::copy(below, below + rb, above.begin());
+        std::copy(below, below + rb, center.begin());
+      }
+      else {
+        filter_row(below, out + n*rb);
+        n++;
+        std::swap(above, center);
+        std::copy(below, below + rb, center.begin());
+      }
+      seen++;
+    }
+    return n;
+  }
+
+  size_t flush(uint8_t* out) override {
+    if(seen == 0)
+      return 0;
+    filter_row(center.data(), out);
+    seen = 0;
+    return 1;
+  }
+
+  private:
+    // Output row between above and below, centered on center
+    void filter_row(const uint8_t* below, uint8_t* out) {
+      if(format.depth() == 1)
+        filter_row<1>(below, out);
+      else
+        filter_row<2>(below, out);
+    }
+
+    template <int D>
+    void filter_row(const uint8_t* below, uint8_t* out) {
+      size_t w = format.width;
+      // Vertical sums, then horizontal sums of three of them
+      for(size_t c=0; c<w; c++)
+        sums[c] = load_sample<D>(above.data(), c) + load_sample<D>(center.data(), c) + load_sample<D>(below, c);
+      for(size_t c=0; c<w; c++) {
+        uint32_t left = sums[c > 0 ? c - 1 : 0];
+        uint32_t right = sums[c + 1 < w ? c + 1 : w - 1];
+        store_sample<D>(out, c, (left + sums[c] + right + 4) / 9);
+      }
+    }
+
+    RasterFormat format;
+    std::vector<uint8_t> above;
+    std::vector<uint8_t> center;
+    std::vector<uint32_t> sums;
+    size_t seen = 0;
+};
+
+// Reader, stages and writer: one strip is read, goes through all the
+// stages and is written before the next one is read
+struct StripPipeline {
+  // Methods
+  template <typename S, typename... Args>
+  StripPipeline& add(Args&&... args) {
+    stages.push_back(std::make_unique<S>(std::forward<Args>(args)...));
+    return *this;
+  }
+
+  void run(const std::string& input, const std::string& output, size_t strip_rows = 64) {
+    NetpbmStripReader reader(input);
+
+    // Format and buffer of one strip between each pair of stages
+    std::vector<RasterFormat> formats = { reader.get_format() };
+    for(auto& s : stages)
+      formats.push_back(s->setup(formats.back()));
+    std::vector<std::vector<uint8_t>> buffers;
+    for(auto& f : formats)
+      buffers.emplace_back(strip_rows * f.row_bytes());
+
+    NetpbmStripWriter writer(output, formats.back());
+
+    size_t count;
+    while((count = reader.read(buffers[0].data(), strip_rows)) > 0) {
+      for(size_t i=0; i<stages.size(); i++)
+        count = stages[i]->process(buffers[i].data(), count, buffers[i + 1].data());
+      writer.write(buffers.back().data(), count);
+    }
+
+    // Rows held back by each stage go through the following ones
+    for(size_t i=0; i<stages.size(); i++) {
+      count = stages[i]->flush(buffers[i + 1].data());
+      for(size_t j=i+1; j<stages.size(); j++)
+        count = stages[j]->process(buffers[j].data(), count, buffers[j + 1].data());
+      writer.write(buffers.back().data(), count);
+    }
+  }
+
+  // Attributes
+  private:
+    std::vector<std::unique_ptr<StripStage>> stages;
+};
+
+#endif
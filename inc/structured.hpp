@@ -0,0 +1,205 @@
+#ifndef STRUCTURED_H
+#define STRUCTURED_H
+
+#include <vector>
+#include <memory>
+
+#include "complex.hpp"
+#include "fft.hpp"
+#include "matrix.hpp"
+
+// Circular convolution with a fixed kernel of length L (power of 2).
+// The spectrum of the kernel is computed once, the workspace is allocated
+// per call so that threads can share the convolver.
+template <typename T>
+struct FftConvolver {
+  // Constructors
+  FftConvolver() = default;
+
+  FftConvolver(const std::vector<T>& kernel) {
+    L = kernel.size();
+    radix = (((size_t)log2(L)) % 2 == 0) ? 4 : 2;
+    bfly = get_butterfly<T>(radix);
+
+    spectrum.resize(L);
+    for(size_t i=0; i<L; i++)
+      spectrum[i] = kernel[i];
+    forward(spectrum);
+
+    // Fold the 1/L of the inverse FFT in the kernel
+    for(size_t i=0; i<L; i++)
+      spectrum[i] /= L;
+  }
+
+  // Methods
+
+  // y[0..m) = (kernel (*) [x, 0...])[0..m), with n <= L and m <= L
+  void apply(const T* x, size_t n, T* y, size_t m) const {
+    std::vector<Cpx<T>> work(L);
+    for(size_t i=0; i<n; i++)
+      work[i] = x[i];
+
+    forward(work);
+    for(size_t i=0; i<L; i++)
+      work[i] = (work[i] * spectrum[i]).conj();
+    // IFFT(z) = conj(FFT(conj(z))) / L, the 1/L is in the kernel
+    forward(work);
+
+    for(size_t i=0; i<m; i++)
+      y[i] = work[i].real();
+  }
+
+  size_t size() const {
+    return L;
+  }
+
+  private:
+    void forward(std::vector<Cpx<T>>& v) const {
+      fft(v.data(), L, radix, bfly.get(), false);
+      reverse_reorder(v.data(), L, radix);
+    }
+
+    size_t L = 0;
+    size_t radix = 2;
+    std::shared_ptr<Bfly<T>> bfly;
+    std::vector<Cpx<T>> spectrum;
+};
+
+inline size_t next_pow2(size_t n) {
+  size_t p = 1;
+  while(p < n)
+    p *= 2;
+  return p;
+}
+
+// Toeplitz matrix: A(i, j) = col[i - j] if i >= j, row[j - i] otherwise.
+// It is embedded in a circulant matrix of size L >= rows + cols - 1, so the
+// matrix-vector product costs O(L log L) instead of O(rows * cols).
+template <typename T>
+struct Toeplitz {
+  // Constructors
+  Toeplitz(const std::vector<T>& col, const std::vector<T>& row)
+  : col { col }, row { row } {
+    if(col.empty() || row.empty()) {
+      std::cout << "A Toeplitz matrix needs a first column and a first row of at least one element." << std::endl;
+      exit(1);
+    }
+    if(col[0] != row[0]) {
+      std::cout << "The first column and the first row of a Toeplitz matrix must start with the same element." << std::endl;
+      exit(1);
+    }
+
+    size_t L = next_pow2(col.size() + row.size() - 1);
+    std::vector<T> kernel(L, 0);
+    for(size_t i=0; i<col.size(); i++)
+      kernel[i] = col[i];
+    for(size_t j=1; j<row.size(); j++)
+      kernel[L - j] = row[j];
+    conv = FftConvolver<T>(kernel);
+  }
+
+  // Methods
+  size_t r() const {
+    return col.size();
+  }
+
+  size_t c() const {
+    return row.size();
+  }
+
+  T get(const size_t r, const size_t c) const {
+    return (r >= c) ? col[r - c] : row[c - r];
+  }
+
+  Matrix<T> dense() const {
+    Matrix<T> res(r(), c());
+    for(size_t i=0; i<r(); i++)
+      for(size_t j=0; j<c(); j++)
+        res(i, j) = get(i, j);
+    return res;
+  }
+
+  // Operators
+  std::vector<T> operator * (const std::vector<T>& a) const {
+    if(a.size() != c()) {
+      std::cout << "Cannot multiply a " << r() << "x" << c() << " matrix by a vector of size " << a.size() << "." << std::endl;
+      exit(1);
+    }
+    std::vector<T> res(r());
+    conv.apply(a.data(), a.size(), res.data(), res.size());
+    return res;
+  }
+
+  // Attributes
+  private:
+    std::vector<T> col;
+    std::vector<T> row;
+    FftConvolver<T> conv;
+};
+
+// Circulant matrix: A(i, j) = col[(i - j) mod n].
+// Sizes that are powers of 2 use an n-point FFT, the others the Toeplitz embedding.
+template <typename T>
+struct Circulant {
+  // Constructors
+  Circulant(const std::vector<T>& col)
+  : col { col } {
+    size_t n = col.size();
+    if(n == 0) {
+      std::cout << "A circulant matrix needs a first column of at least one element." << std::endl;
+      exit(1);
+    }
+    if(n == next_pow2(n)) {
+      conv = FftConvolver<T>(col);
+    }
+    else {
+      size_t L = next_pow2(2*n - 1);
+      std::vector<T> kernel(L, 0);
+      for(size_t i=0; i<n; i++)
+        kernel[i] = col[i];
+      for(size_t j=1; j<n; j++)
+        kernel[L - j] = col[n - j];
+      conv = FftConvolver<T>(kernel);
+    }
+  }
+
+  // Methods
+  size_t r() const {
+    return col.size();
+  }
+
+  size_t c() const {
+    return col.size();
+  }
+
+  T get(const size_t r, const size_t c) const {
+    size_t n = col.size();
+    return col[(r + n - c) % n];
+  }
+
+  Matrix<T> dense() const {
+    Matrix<T> res(r(), c());
+    for(size_t i=0; i<r(); i++)
+      for(size_t j=0; j<c(); j++)
+        res(i, j) = get(i, j);
+    return res;
+  }
+
+  // Operators
+  std::vector<T> operator * (const std::vector<T>& a) const {
+    if(a.size() != c()) {
+      std::cout << "Cannot multiply a " << r() << "x" << c() << " matrix by a vector of size " << a.size() << "." << std::endl;
+      exit(1);
+    }
+    std::vector<T> res(r());
+    conv.apply(a.data(), a.size(), res.data(), res.size());
+    return res;
+  }
+
+  // Attributes
+  private:
+    std::vector<T> col;
+    FftConvolver<T> conv;
+};
+
+#endif
@@ -1,9 +1,21 @@
+#ifndef WAV_H
+#define WAV_H
+
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <fstream>
 #include <vector>
+#include <string>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <thread>
+
+#include "mmap.hpp"
+#include "pcm.hpp"
+#include "pipeline.hpp"
 
 // Thanks to https://truelogic.org/wordpress/2015/09/04/parsing-a-wav-file-in-c/
 
@@ -23,6 +35,7 @@ struct WavHeader {
   unsigned int byte_rate;        // sample_rate * num_channels * bits_per_sample / 8
   unsigned int block_align;      // num_channels * bits_per_sample / 8
   unsigned int bits_per_sample;  // bits per sample (8, 16...)
+  unsigned int sample_format;    // audio_format, or the sub-format of WAVE_FORMAT_EXTENSIBLE (0xFFFE)
   // data sub-chunk
   char subchunk2_id[4];          // 'DATA' string or 'FLLR' string
   unsigned int subchunk2_size;   // size of data in bytes: num_samples * num_channels * bits_per_sample / 8
@@ -39,15 +52,142 @@ struct WavHeader {
   char little_subchunk2_size[4];
 };
 
-unsigned int little_to_big_endian_4(unsigned char* in) {
+inline unsigned int little_to_big_endian_4(unsigned char* in) {
   return ( in[0] | (in[1] << 8) | (in[2] << 16) | (in[3] << 24) );
 }
 
-unsigned int little_to_big_endian_2(unsigned char* in) {
+inline unsigned int little_to_big_endian_2(unsigned char* in) {
   return ( in[0] | (in[1] << 8) );
 }
 
-void read_wav_header(std::ifstream& fs, WavHeader& header, bool verbose) {
+inline void big_to_little_endian_4(unsigned int in, char* out) {
+  out[0] = (char)(in      );
+  out[1] = (char)(in >>  8);
+  out[2] = (char)(in >> 16);
+  out[3] = (char)(in >> 24);
+}
+
+inline void big_to_little_endian_2(unsigned int in, char* out) {
+  out[0] = (char)(in     );
+  out[1] = (char)(in >> 8);
+}
+
+// Fill a canonical 44-byte header for num_frames frames
+inline void init_wav_header(WavHeader& header, unsigned int audio_format, unsigned int num_channels, unsigned int sample_rate, unsigned int bits_per_sample, size_t num_frames) {
+  memcpy(header.riff, "RIFF", 4);
+  memcpy(header.wave, "WAVE", 4);
+  memcpy(header.subchunk1_id, "fmt ", 4);
+  memcpy(header.subchunk2_id, "data", 4);
+
+  header.subchunk1_size = 16;
+  header.audio_format = audio_format;
+  header.sample_format = audio_format;
+  header.num_channels = num_channels;
+  header.sample_rate = sample_rate;
+  header.bits_per_sample = bits_per_sample;
+  header.block_align = num_channels * bits_per_sample / 8;
+  header.byte_rate = sample_rate * header.block_align;
+  header.subchunk2_size = num_frames * header.block_align;
+  header.chunk_size = 4 + (8 + header.subchunk1_size) + (8 + header.subchunk2_size);
+
+  big_to_little_endian_4(header.chunk_size, header.little_chunk_size);
+  big_to_little_endian_4(header.subchunk1_size, header.little_subchunk1_size);
+  big_to_little_endian_2(header.audio_format, header.little_audio_format);
+  big_to_little_endian_2(header.num_channels, header.little_num_channels);
+  big_to_little_endian_4(header.sample_rate, header.little_sample_rate);
+  big_to_little_endian_4(header.byte_rate, header.little_byte_rate);
+  big_to_little_endian_2(header.block_align, header.little_block_align);
+  big_to_little_endian_2(header.bits_per_sample, header.little_bits_per_sample);
+  big_to_little_endian_4(header.subchunk2_size, header.little_subchunk2_size);
+}
+
+// Fields of a fmt sub-chunk (chunk points to its "fmt " id). The first 16
+// bytes of the body are needed, 40 for WAVE_FORMAT_EXTENSIBLE.
+inline void parse_fmt_chunk(const unsigned char* chunk, WavHeader& header) {
+  memcpy(header.subchunk1_id, chunk, 4);
+  memcpy(header.little_subchunk1_size, chunk + 4, 4);
+  memcpy(header.little_audio_format, chunk + 8, 2);
+  memcpy(header.little_num_channels, chunk + 10, 2);
+  memcpy(header.little_sample_rate, chunk + 12, 4);
+  memcpy(header.little_byte_rate, chunk + 16, 4);
+  memcpy(header.little_block_align, chunk + 20, 2);
+  memcpy(header.little_bits_per_sample, chunk + 22, 2);
+  header.subchunk1_size = little_to_big_endian_4((unsigned char *)header.little_subchunk1_size);
+  header.audio_format = little_to_big_endian_2((unsigned char *)header.little_audio_format);
+  header.num_channels = little_to_big_endian_2((unsigned char *)header.little_num_channels);
+  header.sample_rate = little_to_big_endian_4((unsigned char *)header.little_sample_rate);
+  header.byte_rate = little_to_big_endian_4((unsigned char *)header.little_byte_rate);
+  header.block_align = little_to_big_endian_2((unsigned char *)header.little_block_align);
+  header.bits_per_sample = little_to_big_endian_2((unsigned char *)header.little_bits_per_sample);
+
+  // The sub-format GUID starts with the format code
+  header.sample_format = header.audio_format;
+  if(header.audio_format == 0xFFFE && header.subchunk1_size >= 40)
+    header.sample_format = little_to_big_endian_2((unsigned char *)chunk + 8 + 24);
+}
+
+inline PcmFormat wav_pcm_format(const WavHeader& header) {
+  return pcm_format(header.sample_format, header.bits_per_sample);
+}
+
+inline void check_block_align(const WavHeader& header) {
+  if(header.block_align == 0 || header.block_align != header.num_channels * header.bits_per_sample / 8) {
+    std::cout << "Error in the header block align." << std::endl;
+    exit(1);
+  }
+}
+
+// Parse the RIFF chunks of a WAV file held in memory. Chunks other than
+// "fmt " and "data" (LIST, fact...) are skipped. data_offset is set to the
+// position of the first sample.
+inline void parse_wav_chunks(const unsigned char* p, size_t size, WavHeader& header, size_t& data_offset) {
+  if(size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) {
+    std::cout << "Not a RIFF/WAVE file." << std::endl;
+    exit(1);
+  }
+  memcpy(header.riff, p, 4);
+  memcpy(header.little_chunk_size, p + 4, 4);
+  header.chunk_size = little_to_big_endian_4((unsigned char *)header.little_chunk_size);
+  memcpy(header.wave, p + 8, 4);
+
+  bool fmt_found = false;
+  size_t pos = 12;
+  while(pos + 8 <= size) {
+    const unsigned char* chunk = p + pos;
+    unsigned int chunk_size = little_to_big_endian_4((unsigned char *)chunk + 4);
+
+    if(memcmp(chunk, "fmt ", 4) == 0) {
+      if(chunk_size < 16 || pos + 8 + std::min(chunk_size, 40u) > size) {
+        std::cout << "Error in the header sub-chunk 1 size." << std::endl;
+        exit(1);
+      }
+      parse_fmt_chunk(chunk, header);
+      fmt_found = true;
+    }
+    else if(memcmp(chunk, "data", 4) == 0) {
+      if(!fmt_found) {
+        std::cout << "The data sub-chunk comes before the fmt sub-chunk." << std::endl;
+        exit(1);
+      }
+      memcpy(header.subchunk2_id, chunk, 4);
+      memcpy(header.little_subchunk2_size, chunk + 4, 4);
+      // A truncated file holds less data than declared
+      header.subchunk2_size = std::min<size_t>(chunk_size, size - pos - 8);
+      data_offset = pos + 8;
+
+      check_block_align(header);
+      return;
+    }
+
+    // Chunks are padded to an even size
+    pos += 8 + chunk_size + (chunk_size & 1);
+  }
+
+  std::cout << "No data sub-chunk found." << std::endl;
+  exit(1);
+}
+
+inline void read_wav_header(std::ifstream& fs, WavHeader& header, bool verbose) {
   // Read RIFF chunk descriptor
   fs.read(header.riff, sizeof(header.riff));
   if(verbose)
@@ -74,18 +214,25 @@ void read_wav_header(std::ifstream& fs, WavHeader& header, bool verbose) {
 
   fs.read(header.little_audio_format, 2);
   header.audio_format = little_to_big_endian_2((unsigned char *)header.little_audio_format);
+  header.sample_format = header.audio_format;
   if(verbose) {
     std::cout << "[20-21] Audio Format: " << header.audio_format << " -> ";
     switch(header.audio_format) {
       case(1):
         std::cout << "PCM";
         break;
+      case(3):
+        std::cout << "IEEE float";
+        break;
       case(6):
         std::cout << "A-law";
         break;
       case(7):
         std::cout << "Mu-law";
         break;
+      case(0xFFFE):
+        std::cout << "Extensible";
+        break;
     }
     std::cout << std::endl;
   }
@@ -142,13 +289,14 @@ void read_wav_header(std::ifstream& fs, WavHeader& header, bool verbose) {
     exit(1);
   }
 
-  if(header.chunk_size != 4 + (8 + header.subchunk1_size) + (8 + header.subchunk2_size)) {
+  // An odd data sub-chunk is followed by a pad byte
+  if(header.chunk_size != 4 + (8 + header.subchunk1_size) + (8 + header.subchunk2_size + (header.subchunk2_size & 1))) {
     std::cout << "Error in the header sub-chunk 2 size." << std::endl;
     exit(1);
   }
 }
 
-void compute_wave_sample_sizes(WavHeader& header, long& num_samples, long& size_of_each_sample, bool verbose) {
+inline void compute_wave_sample_sizes(WavHeader& header, long& num_samples, long& size_of_each_sample, bool verbose) {
   long bits_per_channel = 8 * header.subchunk2_size;
   long num_samples_per_channel = bits_per_channel / header.bits_per_sample;
   num_samples = num_samples_per_channel / header.num_channels;
@@ -164,71 +312,66 @@ void compute_wave_sample_sizes(WavHeader& header, long& num_samples, long& size_
     std::cout << "Duration: " << duration_in_seconds << " s" << std::endl;
 } 
 
+// Walk the chunks of a WAV stream up to its first sample, skipping chunks
+// other than "fmt " and "data" like parse_wav_chunks()
+inline void read_wav_chunks(std::istream& fs, WavHeader& header) {
+  unsigned char riff[12];
+  fs.read((char*)riff, 12);
+  if(fs.gcount() != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+    std::cout << "Not a RIFF/WAVE file." << std::endl;
+    exit(1);
+  }
+  memcpy(header.riff, riff, 4);
+  memcpy(header.little_chunk_size, riff + 4, 4);
+  header.chunk_size = little_to_big_endian_4((unsigned char *)header.little_chunk_size);
+  memcpy(header.wave, riff + 8, 4);
+
+  bool fmt_found = false;
+  unsigned char chunk[8 + 40];
+  while(fs.read((char*)chunk, 8)) {
+    unsigned int chunk_size = little_to_big_endian_4(chunk + 4);
+    if(memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16) {
+      unsigned int n = std::min(chunk_size, 40u);
+      fs.read((char*)chunk + 8, n);
+      parse_fmt_chunk(chunk, header);
+      fs.seekg(chunk_size - n + (chunk_size & 1), std::ios::cur);
+      fmt_found = true;
+    }
+    else if(memcmp(chunk, "data", 4) == 0) {
+      if(!fmt_found) {
+        std::cout << "The data sub-chunk comes before the fmt sub-chunk." << std::endl;
+        exit(1);
+      }
+      memcpy(header.subchunk2_id, chunk, 4);
+      memcpy(header.little_subchunk2_size, chunk + 4, 4);
+      header.subchunk2_size = chunk_size;
+      check_block_align(header);
+      return;
+    }
+    else {
+      fs.seekg(chunk_size + (chunk_size & 1), std::ios::cur);
+    }
+  }
+  std::cout << "No data sub-chunk found." << std::endl;
+  exit(1);
+}
+
 template <typename T>
 void read_pcm_wav_data(std::ifstream& fs, WavHeader& header, long num_samples, long size_of_each_sample, std::vector<T>& out) {
 
   if(header.num_channels > 1) {
-    std::cout << "More than one channel (" << header.num_channels << "), read not supported for now." << std::endl;
+    std::cout << "More than one channel (" << header.num_channels << "), read them into planar buffers." << std::endl;
     exit(1);
   }
 
-  char data_buffer[size_of_each_sample];
-  long bytes_in_each_channel = size_of_each_sample / header.num_channels;
-
-  // The valid amplitude range for values based on the bits per sample
-  //long low_limit = 0l;
-  //switch(header.bits_per_sample) {
-  //  case 8:
-  //    low_limit = -128;
-  //    break;
-  //  case 16:
-  //    low_limit = -32768;
-  //    break;
-  //  case 32:
-  //    low_limit = -2147483648;
-  //    break;
-  //}          
-  //long high_limit = -low_limit - 1;
-
-  for (size_t i=0; i<num_samples; i++) {
-    fs.read(data_buffer, sizeof(data_buffer));
-
-    int data_in_channel = 0;
-    int offset = 0;
-
-    //for(unsigned int xchannels = 0; xchannels < header.num_channels; xchannels++) {
-
-    // Convert data from little endian to big endian based on bytes in each channel sample
-    switch(bytes_in_each_channel) {
-      case 4:
-        data_in_channel = ((data_buffer[offset    ] & 0x00ff)      )
-                        | ((data_buffer[offset + 1] & 0x00ff) << 8 )
-                        | ((data_buffer[offset + 2] & 0x00ff) << 16)
-                        | ((data_buffer[offset + 3]         ) << 24);
-        break;
-      case 2:
-        data_in_channel = ((data_buffer[offset    ] & 0x00ff)     )
-                        | ((data_buffer[offset + 1]         ) << 8);
-        break;
-      case 1:
-        data_in_channel = data_buffer[offset] & 0x00ff;
-        data_in_channel -= 128; // 8-bit are unsigned, so shifting to signed
-        break;
-    }
-
-    // Save real input in vector
-    out[i] = data_in_channel;
-
-    // Check if sample was in range
-    //if (data_in_channel < low_limit || data_in_channel > high_limit)
-    //  printf("**value out of range\n");
+  // One read for the whole block, then one conversion loop
+  std::vector<unsigned char> data_buffer(num_samples * size_of_each_sample);
+  fs.read((char*)data_buffer.data(), data_buffer.size());
 
-    //offset += bytes_in_each_channel;    
-    //}
-  }
+  pcm_to_real(data_buffer.data(), num_samples, wav_pcm_format(header), out.data());
 }
 
-void write_wav_header(std::ofstream& fs, WavHeader header) {
+inline void write_wav_header(std::ofstream& fs, WavHeader header) {
   fs.write(header.riff, 4);
   fs.write(header.little_chunk_size, 4);
   fs.write(header.wave, 4);
@@ -245,44 +388,18 @@ void write_wav_header(std::ofstream& fs, WavHeader header) {
 } 
 
 template <typename T>
-void write_pcm_wav_data(std::ofstream& fs, WavHeader& header, long num_samples, long size_of_each_sample, std::vector<T> out) {
-  char data_buffer[size_of_each_sample];
-  long bytes_in_each_channel = size_of_each_sample / header.num_channels;
-
-  for (size_t i=0; i<num_samples; i++) {
-    int data = int(out[i]);
-
-    // Convert data from big endian to little endian
-    switch(bytes_in_each_channel) {
-      case 4:
-        // TODO
-        printf("TODO\n");
-        exit(1);
-        break;
-      case 2:
-        data_buffer[0] = (char)(data     );
-        data_buffer[1] = (char)(data >> 8);
-        break;
-      case 1:
-        // TODO
-        printf("TODO\n");
-        exit(1);
-        break;
-    }
-
-    fs.write(data_buffer, sizeof(data_buffer));
-  }
+void write_pcm_wav_data(std::ofstream& fs, WavHeader& header, long num_samples, long size_of_each_sample, const std::vector<T>& out, double scale = 1, PcmDither* dither = nullptr) {
+  // One conversion loop, then one write for the whole block
+  std::vector<unsigned char> data_buffer(num_samples * size_of_each_sample);
+  real_to_pcm(out.data(), num_samples * header.num_channels, wav_pcm_format(header), data_buffer.data(), scale, dither);
+  fs.write((char*)data_buffer.data(), data_buffer.size());
 }
 
 template <typename T>
 void signal_from_wav_file(std::ifstream& fs, WavHeader& header, std::vector<T>& x, bool all) {
-  // Read header
-  read_wav_header(fs, header, false);
-
-  if (header.audio_format != 1) { // PCM only
-    std::cout << "Only PCM is supported." << std::endl;
-    exit(1);
-  }
+  // Read header, check that the format is supported
+  read_wav_chunks(fs, header);
+  wav_pcm_format(header);
 
   // Compute signal size
   long num_samples, size_of_each_sample;
@@ -306,3 +423,410 @@ void signal_from_wav_file(std::ifstream& fs, WavHeader& header, std::vector<T>&
     read_pcm_wav_data<T>(fs, header, N, size_of_each_sample, x);
   }
 }
+
+// Read every channel into its own buffer: x[c][i] is frame i of channel c
+template <typename T>
+void signal_from_wav_file(std::ifstream& fs, WavHeader& header, std::vector<std::vector<T>>& x) {
+  read_wav_chunks(fs, header);
+  PcmFormat format = wav_pcm_format(header);
+
+  long num_samples, size_of_each_sample;
+  compute_wave_sample_sizes(header, num_samples, size_of_each_sample, true);
+
+  std::vector<unsigned char> data_buffer(num_samples * size_of_each_sample);
+  fs.read((char*)data_buffer.data(), data_buffer.size());
+
+  x.resize(header.num_channels);
+  std::vector<T*> out(header.num_channels);
+  for(size_t c=0; c<x.size(); c++) {
+    x[c].resize(num_samples);
+    out[c] = x[c].data();
+  }
+  pcm_to_planar(data_buffer.data(), num_samples, header.num_channels, format, out.data());
+}
+
+// WAV file mapped in memory. The header is parsed in place and the samples
+// are not copied: they can be seen as a span of the type stored in the file,
+// or converted to numbers only for the range that is needed.
+struct WavMap {
+  // Constructor
+  WavMap(const std::string& filename)
+  : file { filename } {
+    parse_wav_chunks(file.data(), file.size(), header, data_offset);
+    format = wav_pcm_format(header);
+  }
+
+  // Methods
+  const WavHeader& get_header() const {
+    return header;
+  }
+
+  // Number of frames (one sample per channel)
+  size_t num_frames() const {
+    return header.subchunk2_size / header.block_align;
+  }
+
+  // Raw little-endian sample bytes
+  const unsigned char* bytes() const {
+    return file.data() + data_offset;
+  }
+
+  // Interleaved samples as stored: S = uint8_t, int16_t or int32_t for 8, 16 and 32-bit PCM
+  template <typename S>
+  std::span<const S> samples() const {
+    if(std::endian::native != std::endian::little) {
+      std::cout << "Samples can only be seen in place on little-endian machines." << std::endl;
+      exit(1);
+    }
+    if(sizeof(S) * 8 != header.bits_per_sample) {
+      std::cout << "Samples have " << header.bits_per_sample << " bits, not " << sizeof(S) * 8 << "." << std::endl;
+      exit(1);
+    }
+    if((uintptr_t)bytes() % alignof(S) != 0) {
+      std::cout << "Samples are not aligned in the file, use read()." << std::endl;
+      exit(1);
+    }
+    return { (const S*)bytes(), header.subchunk2_size / sizeof(S) };
+  }
+
+  // Convert count frames from frame first to out (count * num_channels interleaved values)
+  template <typename T>
+  void read(size_t first, size_t count, T* out, double scale = 1) const {
+    if(first + count > num_frames()) {
+      std::cout << "Frames " << first << " to " << first + count << " are out of the file (" << num_frames() << " frames)." << std::endl;
+      exit(1);
+    }
+    pcm_to_real(bytes() + first * header.block_align, count * header.num_channels, format, out, scale);
+  }
+
+  // Same, but channel c goes to out[c][0 .. count-1]
+  template <typename T>
+  void read_planar(size_t first, size_t count, T* const* out, double scale = 1) const {
+    if(first + count > num_frames()) {
+      std::cout << "Frames " << first << " to " << first + count << " are out of the file (" << num_frames() << " frames)." << std::endl;
+      exit(1);
+    }
+    pcm_to_planar(bytes() + first * header.block_align, count, header.num_channels, format, out, scale);
+  }
+
+  // Attributes
+  private:
+    MappedFile file;
+    WavHeader header;
+    PcmFormat format;
+    size_t data_offset = 0;
+};
+
+// Read a WAV file block by block into buffers owned by the caller, so files
+// of any length are processed with constant memory.
+struct WavReader {
+  // Constructor
+  WavReader(const std::string& filename, size_t buffer_size = 1 << 20)
+  : stream_buffer(buffer_size) {
+    // Large stream buffer, set before opening
+    fs.rdbuf()->pubsetbuf(stream_buffer.data(), stream_buffer.size());
+    fs.open(filename, std::ios::binary);
+    if(!fs.is_open()) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+    read_wav_chunks(fs, header);
+    format = wav_pcm_format(header);
+    raw.resize(std::max<size_t>(buffer_size / header.block_align, 1) * header.block_align);
+  }
+
+  // Methods
+  const WavHeader& get_header() const {
+    return header;
+  }
+
+  size_t num_frames() const {
+    return header.subchunk2_size / header.block_align;
+  }
+
+  // Frames read so far
+  size_t position() const {
+    return frame;
+  }
+
+  // Read up to out.size() / num_channels frames (interleaved values).
+  // Returns the number of frames read, 0 at the end of the file.
+  template <typename T>
+  size_t read(std::span<T> out, double scale = 1) {
+    size_t frames = std::min(out.size() / header.num_channels, num_frames() - frame);
+    size_t done = 0;
+    while(done < frames) {
+      size_t n = std::min(frames - done, raw.size() / header.block_align);
+      fs.read((char*)raw.data(), n * header.block_align);
+      size_t got = fs.gcount() / header.block_align;
+      pcm_to_real(raw.data(), got * header.num_channels, format, out.data() + done * header.num_channels, scale);
+      done += got;
+      if(got < n)
+        break; // truncated file
+    }
+    frame += done;
+    return done;
+  }
+
+  // Read up to frames frames, channel c to out[c]. Returns the number of frames read.
+  template <typename T>
+  size_t read_planar(T* const* out, size_t frames, double scale = 1) {
+    frames = std::min(frames, num_frames() - frame);
+    std::vector<T*> dst(out, out + header.num_channels);
+    size_t done = 0;
+    while(done < frames) {
+      size_t n = std::min(frames - done, raw.size() / header.block_align);
+      fs.read((char*)raw.data(), n * header.block_align);
+      size_t got = fs.gcount() / header.block_align;
+      for(size_t c=0; c<dst.size(); c++)
+        dst[c] = out[c] + done;
+      pcm_to_planar(raw.data(), got, header.num_channels, format, dst.data(), scale);
+      done += got;
+      if(got < n)
+        break; // truncated file
+    }
+    frame += done;
+    return done;
+  }
+
+  // Attributes
+  private:
+    std::vector<char> stream_buffer;
+    std::ifstream fs;
+    WavHeader header;
+    PcmFormat format;
+    std::vector<unsigned char> raw;
+    size_t frame = 0;
+};
+
+// Write a WAV file block by block. The sizes in the header are only known
+// at the end: they are patched by close() (also called by the destructor).
+struct WavWriter {
+  // Constructor
+  WavWriter(const std::string& filename, unsigned int audio_format, unsigned int num_channels, unsigned int sample_rate, unsigned int bits_per_sample, size_t buffer_size = 1 << 20)
+  : stream_buffer(buffer_size) {
+    init_wav_header(header, audio_format, num_channels, sample_rate, bits_per_sample, 0);
+    format = wav_pcm_format(header);
+    fs.rdbuf()->pubsetbuf(stream_buffer.data(), stream_buffer.size());
+    fs.open(filename, std::ios::binary);
+    if(!fs.is_open()) {
+      std::cout << "Cannot open " << filename << std::endl;
+      exit(1);
+    }
+    write_wav_header(fs, header);
+    raw.resize(std::max<size_t>(buffer_size / header.block_align, 1) * header.block_align);
+  }
+
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+
+  // Destructor
+  ~WavWriter() {
+    close();
+  }
+
+  // Methods
+  const WavHeader& get_header() const {
+    return header;
+  }
+
+  // TPDF dither on integer PCM
+  void set_dither(bool enable) {
+    dither_enabled = enable;
+  }
+
+  // Write in.size() / num_channels frames (interleaved values times scale)
+  template <typename T>
+  void write(std::span<T> in, double scale = 1) {
+    size_t frames = in.size() / header.num_channels;
+    size_t done = 0;
+    while(done < frames) {
+      size_t n = std::min(frames - done, raw.size() / header.block_align);
+      real_to_pcm(in.data() + done * header.num_channels, n * header.num_channels, format, raw.data(), scale, dither_enabled ? &dither : nullptr);
+      fs.write((char*)raw.data(), n * header.block_align);
+      done += n;
+    }
+    num_frames += frames;
+  }
+
+  template <typename T>
+  void write(const T* in, size_t count, double scale = 1) {
+    write(std::span<const T>(in, count), scale);
+  }
+
+  // Write frames frames, channel c taken from in[c]
+  template <typename T>
+  void write_planar(const T* const* in, size_t frames, double scale = 1) {
+    std::vector<const T*> src(in, in + header.num_channels);
+    size_t done = 0;
+    while(done < frames) {
+      size_t n = std::min(frames - done, raw.size() / header.block_align);
+      for(size_t c=0; c<src.size(); c++)
+        src[c] = in[c] + done;
+      planar_to_pcm(src.data(), n, header.num_channels, format, raw.data(), scale, dither_enabled ? &dither : nullptr);
+      fs.write((char*)raw.data(), n * header.block_align);
+      done += n;
+    }
+    num_frames += frames;
+  }
+
+  void close() {
+    if(!fs.is_open())
+      return;
+
+    init_wav_header(header, header.audio_format, header.num_channels, header.sample_rate, header.bits_per_sample, num_frames);
+    if(header.subchunk2_size & 1) {
+      // Chunks are word aligned
+      fs.put(0);
+      big_to_little_endian_4(header.chunk_size + 1, header.little_chunk_size);
+    }
+    fs.seekp(4);
+    fs.write(header.little_chunk_size, 4);
+    fs.seekp(40);
+    fs.write(header.little_subchunk2_size, 4);
+    fs.close();
+  }
+
+  // Attributes
+  private:
+    std::vector<char> stream_buffer;
+    std::ofstream fs;
+    WavHeader header;
+    PcmFormat format;
+    PcmDither dither;
+    bool dither_enabled = false;
+    std::vector<unsigned char> raw;
+    size_t num_frames = 0;
+};
+
+// WavReader running on a background thread: the next blocks are read and
+// converted into a ring of buffers while the caller works on the current one.
+template <typename T>
+struct AsyncWavReader {
+  // Constructor
+  AsyncWavReader(const std::string& filename, size_t block_frames, size_t slots = 3, double scale = 1)
+  : reader { filename },
+    channels { reader.get_header().num_channels },
+    queue(slots, block_frames * channels) {
+    worker = std::thread([this, scale] { run(scale); });
+  }
+
+  // Destructor
+  ~AsyncWavReader() {
+    queue.cancel();
+    worker.join();
+  }
+
+  // Methods
+  const WavHeader& get_header() const {
+    return reader.get_header();
+  }
+
+  size_t num_frames() const {
+    return reader.num_frames();
+  }
+
+  // Next block of interleaved frames (at most block_frames), valid until
+  // the next call. Empty at the end of the file.
+  std::span<const T> next() {
+    if(holding) {
+      queue.release();
+      holding = false;
+    }
+    T* data;
+    size_t count;
+    if(!queue.pop(data, count))
+      return {};
+    holding = true;
+    return { data, count };
+  }
+
+  // Attributes
+  private:
+    void run(double scale) {
+      for(;;) {
+        T* block = queue.acquire();
+        if(block == nullptr)
+          break;
+        size_t frames = reader.read(std::span<T>(block, queue.block_size()), scale);
+        if(frames == 0)
+          break;
+        queue.push(frames * channels);
+      }
+      queue.finish();
+    }
+
+    WavReader reader;
+    size_t channels;
+    BlockQueue<T> queue;
+    bool holding = false;
+    std::thread worker;
+};
+
+// WavWriter running on a background thread: the caller fills blocks of a
+// ring and goes on computing while the previous blocks are converted and
+// written. close() (or the destructor) waits for the queued blocks.
+template <typename T>
+struct AsyncWavWriter {
+  // Constructor
+  AsyncWavWriter(const std::string& filename, unsigned int audio_format, unsigned int num_channels, unsigned int sample_rate, unsigned int bits_per_sample, size_t block_frames, size_t slots = 3, double scale = 1)
+  : writer(filename, audio_format, num_channels, sample_rate, bits_per_sample),
+    channels { num_channels },
+    queue(slots, block_frames * num_channels) {
+    worker = std::thread([this, scale] { run(scale); });
+  }
+
+  // Destructor
+  ~AsyncWavWriter() {
+    close();
+  }
+
+  // Methods
+  // Free block to fill with up to block_frames interleaved frames
+  std::span<T> buffer() {
+    return { queue.acquire(), queue.block_size() };
+  }
+
+  // Queue the block from buffer(), holding frames frames
+  void commit(size_t frames) {
+    queue.push(frames * channels);
+  }
+
+  // Copy count interleaved values (whole frames) through the ring
+  void write(const T* in, size_t count) {
+    while(count >= channels) {
+      std::span<T> block = buffer();
+      size_t n = std::min(count, block.size()) / channels * channels;
+      std::copy(in, in + n, block.data());
+      commit(n / channels);
+      in += n;
+      count -= n;
+    }
+  }
+
+  void close() {
+    if(!worker.joinable())
+      return;
+    queue.finish();
+    worker.join();
+    writer.close();
+  }
+
+  // Attributes
+  private:
+    void run(double scale) {
+      T* data;
+      size_t count;
+      while(queue.pop(data, count)) {
+        writer.write(data, count, scale);
+        queue.release();
+      }
+    }
+
+    WavWriter writer;
+    size_t channels;
+    BlockQueue<T> queue;
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "conv2d.hpp"
+#include "assert.hpp"
+#include "random.hpp"
+
+// Convolution by its definition, with repeated borders
+std::vector<double> reference(const std::vector<double>& x, size_t width, size_t height, const std::vector<double>& k, size_t rows, size_t cols) {
+  std::vector<double> y(width * height, 0);
+  long ar = (rows - 1) / 2;
+  long ac = (cols - 1) / 2;
+  for(long r=0; r<(long)height; r++)
+    for(long c=0; c<(long)width; c++)
+      for(long i=0; i<(long)rows; i++)
+        for(long j=0; j<(long)cols; j++)
+          y[r*width + c] += k[i*cols + j] * x[std::clamp<long>(r + ar - i, 0, height - 1) * width + std::clamp<long>(c + ac - j, 0, width - 1)];
+  return y;
+}
+
+// Largest error relative to the largest reference value
+double max_error(const std::vector<double>& a, const std::vector<double>& b) {
+  double e = 0;
+  double m = 0;
+  for(size_t i=0; i<a.size(); i++) {
+    e = std::max(e, std::abs(a[i] - b[i]));
+    m = std::max(m, std::abs(b[i]));
+  }
+  return e / m;
+}
+
+int main() {
+  double delta = get_delta<double>();
+
+  // Sizes that are not multiples of the tiles, and an odd number of tiles
+  std::vector<std::vector<size_t>> sizes = {
+    {3, 3, 100, 77},
+    {4, 6, 45, 130},
+    {17, 16, 150, 61},
+    {31, 31, 300, 200},
+  };
+
+  for(size_t s=0; s<sizes.size(); s++) {
+    size_t rows = sizes[s][0];
+    size_t cols = sizes[s][1];
+    size_t width = sizes[s][2];
+    size_t height = sizes[s][3];
+
+    std::cout << "[" << rows << " x " << cols << " kernel, " << width << " x " << height << " image]" << std::endl;
+
+    std::vector<double> x(width * height);
+    for(size_t i=0; i<x.size(); i++)
+      x[i] = real_rand<double>();
+    std::vector<double> k(rows * cols);
+    for(size_t i=0; i<k.size(); i++)
+      k[i] = real_rand<double>();
+    std::vector<double> ref = reference(x, width, height, k, rows, cols);
+    std::vector<double> y(width * height);
+
+    std::cout << " Direct" << std::endl;
+    Convolver2D<double> direct(k, rows, cols, false, Conv2DMethod::direct);
+    direct.apply(x.data(), y.data(), width, height);
+    ASSERT_REAL(max_error(y, ref), 0, delta);
+
+    std::cout << " FFT" << std::endl;
+    Convolver2D<double> fft(k, rows, cols, false, Conv2DMethod::fft);
+    fft.apply(x.data(), y.data(), width, height);
+    ASSERT_REAL(max_error(y, ref), 0, delta);
+    fft.apply(x.data(), y.data(), width, height, 1);
+    ASSERT_REAL(max_error(y, ref), 0, delta);
+
+    std::cout << " Correlation" << std::endl;
+    std::vector<double> flipped(k.rbegin(), k.rend());
+    Convolver2D<double> corr(flipped, rows, cols, true);
+    corr.apply(x.data(), y.data(), width, height);
+    ASSERT_REAL(max_error(y, ref), 0, delta);
+  }
+
+  std::cout << "[method choice]" << std::endl;
+  {
+    ASSERT_REAL((Convolver2D<float>(box_kernel<float>(15), 15, 15).uses_fft()), 0, 0);
+    ASSERT_REAL((!Convolver2D<float>(box_kernel<float>(17), 17, 17).uses_fft()), 0, 0);
+  }
+
+  std::cout << "[images]" << std::endl;
+  {
+    // Normalized kernels keep a flat image, and the unsharp mask a ramp
+    size_t width = 40;
+    size_t height = 30;
+    std::vector<uint8_t> rgb(3 * width * height);
+    for(size_t r=0; r<height; r++)
+      for(size_t c=0; c<width; c++)
+        for(size_t ch=0; ch<3; ch++)
+          rgb[3*(r*width + c) + ch] = (ch == 0) ? 100 : 4 * c;
+    netpbm img("P6", width, height, 255, rgb.data());
+
+    Convolver2D<float> blur(gaussian_kernel<float>(3), gaussian_size(3), gaussian_size(3));
+    ASSERT_REAL((!blur.uses_fft()), 0, 0);
+    netpbm out = convolve(img, blur);
+    for(size_t i=0; i<width*height; i++)
+      ASSERT_REAL(std::abs(out.data()[3*i] - 100), 0, 0);
+
+    Convolver2D<float> sharp(unsharp_kernel<float>(1, 1.5), gaussian_size(1), gaussian_size(1));
+    out = convolve(img, sharp);
+    for(size_t r=0; r<height; r++)
+      for(size_t c=3; c<width-3; c++)
+        ASSERT_REAL(std::abs(out.data()[3*(r*width + c) + 1] - rgb[3*(r*width + c) + 1]), 0, 1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include "dctcodec.hpp"
+#include "dct.hpp"
+#include "assert.hpp"
+#include "random.hpp"
+
+double psnr(const netpbm& a, const netpbm& b) {
+  double mse = 0;
+  for(size_t i=0; i<a.get_bytes(); i++)
+    mse += ((double)a.data()[i] - b.data()[i]) * ((double)a.data()[i] - b.data()[i]);
+  mse /= a.get_bytes();
+  return 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+// Smooth color gradients with a little noise
+netpbm test_image(size_t width, size_t height, size_t channels) {
+  std::vector<uint8_t> raster(width * height * channels);
+  for(size_t y=0; y<height; y++)
+    for(size_t x=0; x<width; x++)
+      for(size_t c=0; c<channels; c++) {
+        double v = 128 + 100 * std::sin(0.05 * x * (c + 1)) * std::cos(0.03 * y) + rand() % 5;
+        raster[(y*width + x)*channels + c] = std::clamp<double>(v, 0, 255);
+      }
+  return netpbm((channels == 3) ? "P6" : "P5", width, height, 255, raster.data());
+}
+
+int main() {
+  std::cout << "[8 x 8 DCT]" << std::endl;
+  {
+    // Orthonormal scaling of the DCT-II of dct.hpp
+    double delta = get_delta<float>();
+    float x[64];
+    float F[64];
+    float y[64];
+    double ref[64];
+    for(size_t i=0; i<64; i++) {
+      x[i] = real_rand<float>();
+      ref[i] = x[i];
+    }
+    dct_8x8(x, F);
+    dctII_2D(ref, 8, 8, 8, 1);
+    for(size_t u=0; u<8; u++)
+      for(size_t v=0; v<8; v++) {
+        double s = (u == 0 ? std::sqrt(0.125) : 0.5) * (v == 0 ? std::sqrt(0.125) : 0.5);
+        ASSERT_REAL(std::abs(F[8*u + v] - s * ref[8*u + v]), 0, delta);
+      }
+    idct_8x8(F, y);
+    for(size_t i=0; i<64; i++)
+      ASSERT_REAL(std::abs(y[i] - x[i]), 0, delta);
+
+    // The zigzag order visits each coefficient once
+    std::vector<size_t> seen(64, 0);
+    for(size_t k=0; k<64; k++)
+      seen[DCT_ZIGZAG[k]]++;
+    for(size_t i=0; i<64; i++)
+      ASSERT_REAL(std::abs((long)seen[i] - 1), 0, 0);
+  }
+
+  std::cout << "[coefficient bits]" << std::endl;
+  {
+    size_t errors = 0;
+    for(int v=-2047; v<=2047; v++) {
+      size_t size = dct_size(v);
+      errors += (dct_raw_bits(v, size) >> size) != 0;
+      errors += dct_extend(dct_raw_bits(v, size), size) != v;
+    }
+    ASSERT_REAL(errors, 0, 0);
+  }
+
+  std::cout << "[roundtrips]" << std::endl;
+  {
+    // RGB and grayscale, sizes that are not multiples of 8
+    for(size_t channels : {3, 1}) {
+      netpbm img = test_image(101, 67, channels);
+      std::vector<uint8_t> packed = dct_encode(img, 90, 1);
+      netpbm out = dct_decode(packed.data(), packed.size(), 1);
+      ASSERT_REAL(std::abs(out.get_width() - 101), 0, 0);
+      ASSERT_REAL(std::abs(out.get_height() - 67), 0, 0);
+      ASSERT_REAL((out.is_rgb() != (channels == 3)), 0, 0);
+      ASSERT_REAL((psnr(img, out) < 35), 0, 0);
+      ASSERT_REAL((packed.size() > img.get_bytes() / 3), 0, 0);
+
+      // Quality 100: steps of 1, only rounding errors
+      packed = dct_encode(img, 100, 1);
+      out = dct_decode(packed.data(), packed.size(), 1);
+      ASSERT_REAL((psnr(img, out) < 45), 0, 0);
+    }
+
+    // Lower qualities give fewer bytes
+    netpbm img = test_image(64, 64, 3);
+    size_t previous = 0;
+    for(size_t quality : {10, 50, 75, 95}) {
+      size_t size = dct_encode(img, quality, 1).size();
+      ASSERT_REAL((size <= previous), 0, 0);
+      previous = size;
+    }
+  }
+
+  std::cout << "[parallel rows]" << std::endl;
+  {
+    // The same stream and image on any number of threads
+    netpbm img = test_image(300, 200, 3);
+    std::vector<uint8_t> ref = dct_encode(img, 75, 1);
+    netpbm ref_out = dct_decode(ref.data(), ref.size(), 1);
+    for(size_t threads : {2, 5}) {
+      std::vector<uint8_t> packed = dct_encode(img, 75, threads);
+      ASSERT_REAL((packed != ref), 0, 0);
+      netpbm out = dct_decode(ref.data(), ref.size(), threads);
+      ASSERT_REAL((!std::equal(out.data(), out.data() + out.get_bytes(), ref_out.data())), 0, 0);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "dwt.hpp"
+#include "assert.hpp"
+#include "random.hpp"
+
+template <typename T>
+double max_diff(const std::vector<T>& a, const std::vector<T>& b) {
+  double e = 0;
+  for(size_t i=0; i<a.size(); i++)
+    e = std::max(e, (double)std::abs(a[i] - b[i]));
+  return e;
+}
+
+int main() {
+  double delta = get_delta<double>();
+  std::vector<Wavelet> wavelets = {Wavelet::haar, Wavelet::cdf53, Wavelet::cdf97};
+  std::vector<std::string> names = {"Haar", "CDF 5/3", "CDF 9/7"};
+
+  for(size_t k=0; k<wavelets.size(); k++) {
+    Wavelet w = wavelets[k];
+    std::cout << "[" << names[k] << "]" << std::endl;
+
+    std::cout << " 1D reconstruction" << std::endl;
+    {
+      std::vector<size_t> sizes = {1, 2, 3, 7, 64, 1001};
+      for(size_t n : sizes) {
+        std::vector<double> x(n);
+        for(size_t i=0; i<n; i++)
+          x[i] = real_rand<double>();
+        for(size_t levels=1; levels<=4; levels++) {
+          std::vector<double> y = x;
+          dwt(y, w, levels);
+          idwt(y, w, levels);
+          ASSERT_REAL(max_diff(x, y), 0, delta);
+        }
+      }
+    }
+
+    std::cout << " Constant and alternating signals" << std::endl;
+    {
+      // Gain 1 at DC: approximation 5, no detail
+      for(size_t n : {16, 17}) {
+        std::vector<double> x(n, 5);
+        dwt(x, w);
+        for(size_t i=0; i<n; i++)
+          ASSERT_REAL(std::abs(x[i] - ((i < (n + 1) / 2) ? 5 : 0)), 0, delta);
+      }
+      // Gain 2 at Nyquist: no approximation, detail -2
+      std::vector<double> x(16);
+      for(size_t i=0; i<16; i++)
+        x[i] = (i % 2) ? -1 : 1;
+      dwt(x, w);
+      for(size_t i=0; i<16; i++) {
+        double ref = (i < 8) ? 0 : -2;
+        ASSERT_REAL(std::abs(x[i] - ref), 0, delta);
+      }
+    }
+
+    std::cout << " 2D reconstruction" << std::endl;
+    {
+      // Odd sizes, stride > cols, big enough to run on several threads
+      std::vector<std::vector<size_t>> sizes = {{9, 13, 16}, {200, 301, 320}};
+      for(auto& s : sizes) {
+        size_t rows = s[0];
+        size_t cols = s[1];
+        size_t stride = s[2];
+        std::vector<float> x(rows * stride);
+        for(size_t i=0; i<x.size(); i++)
+          x[i] = real_rand<float>();
+        std::vector<float> y = x;
+        dwt_2D(y.data(), rows, cols, stride, w, 3);
+        idwt_2D(y.data(), rows, cols, stride, w, 3);
+        ASSERT_REAL(max_diff(x, y), 0, get_delta<float>());
+      }
+    }
+
+    std::cout << " 2D equals rows then columns" << std::endl;
+    {
+      size_t rows = 12;
+      size_t cols = 10;
+      std::vector<double> x(rows * cols);
+      for(size_t i=0; i<x.size(); i++)
+        x[i] = real_rand<double>();
+      std::vector<double> ref = x;
+      std::vector<double> scratch(rows);
+      std::vector<double> line(rows);
+      for(size_t r=0; r<rows; r++)
+        dwt_level(ref.data() + r*cols, cols, w, scratch.data());
+      for(size_t c=0; c<cols; c++) {
+        for(size_t r=0; r<rows; r++)
+          line[r] = ref[r*cols + c];
+        dwt_level(line.data(), rows, w, scratch.data());
+        for(size_t r=0; r<rows; r++)
+          ref[r*cols + c] = line[r];
+      }
+      dwt_2D(x.data(), rows, cols, cols, w);
+      ASSERT_REAL(max_diff(x, ref), 0, delta);
+    }
+  }
+
+  std::cout << "[CDF 5/3 filters]" << std::endl;
+  {
+    // Away from the borders the lifting steps are the 5-tap low-pass and
+    // 3-tap high-pass filters
+    size_t n = 32;
+    std::vector<double> x(n);
+    for(size_t i=0; i<n; i++)
+      x[i] = real_rand<double>();
+    std::vector<double> y = x;
+    dwt(y, Wavelet::cdf53);
+    for(size_t i=2; i<n/2-2; i++) {
+      double low = -x[2*i - 2] / 8 + x[2*i - 1] / 4 + 3 * x[2*i] / 4 + x[2*i + 1] / 4 - x[2*i + 2] / 8;
+      double high = -x[2*i] / 2 + x[2*i + 1] - x[2*i + 2] / 2;
+      ASSERT_REAL(std::abs(y[i] - low), 0, delta);
+      ASSERT_REAL(std::abs(y[n/2 + i] - high), 0, delta);
+    }
+  }
+
+  return 0;
+}
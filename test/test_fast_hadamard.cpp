@@ -1,6 +1,22 @@
 #include "hadamard.hpp"
 #include "assert.hpp"
 
+// Unnormalized radix-2 reference
+template <typename T>
+void walsh_hadamard_reference(std::vector<T>& a) {
+  size_t N = a.size();
+  for(size_t h=1; h<N; h*=2) {
+    for(size_t i=0; i<N; i+=2*h) {
+      for(size_t j=i; j<i+h; j++) {
+        T x = a[j];
+        T y = a[j + h];
+        a[j] = x + y;
+        a[j + h] = x - y;
+      }
+    }
+  }
+}
+
 int main() {
   std::vector<size_t> Nvec = {8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
 
@@ -29,7 +45,87 @@ int main() {
     }
   }
 
-  return 0;
-}
+  std::vector<size_t> Nlarge = {1, 2, 4, 1 << 13, 1 << 16, 1 << 19};
+
+  for(size_t i=0; i<Nlarge.size(); i++) {
+    size_t N = Nlarge[i];
+
+    std::cout << "[N = " << N << ", normalizations]" << std::endl;
+
+    std::vector<double> x(N);
+    for(size_t i=0; i<N; i++) {
+      x[i] = real_rand<double>();
+    }
+
+    std::vector<double> ref = x;
+    walsh_hadamard_reference(ref);
+
+    double delta = get_delta<double>() * sqrt(N);
+
+    std::vector<double> y = x;
+    fast_walsh_hadamard(y, WhtNorm::none);
+    for(size_t i=0; i<N; i++) {
+      ASSERT_REAL(std::abs(y[i] - ref[i]), 0, delta);
+    }
+
+    y = x;
+    fast_walsh_hadamard(y, WhtNorm::custom, 0.5);
+    for(size_t i=0; i<N; i++) {
+      ASSERT_REAL(std::abs(y[i] - 0.5 * ref[i]), 0, delta);
+    }
+
+    // Orthonormal transform twice gives the input back
+    y = x;
+    fast_walsh_hadamard(y);
+    fast_walsh_hadamard(y);
+    for(size_t i=0; i<N; i++) {
+      ASSERT_REAL(std::abs(y[i] - x[i]), 0, delta);
+    }
 
+    // Implicit Kronecker product of N/2 x N/2 H1 factors
+    if(N > 1) {
+      KroneckerOperator<double> Hn = walsh_hadamard_operator(N);
+      y = x;
+      fast_walsh_hadamard(y);
+      std::vector<double> z = Hn * x;
+      for(size_t i=0; i<N; i++) {
+        ASSERT_REAL(std::abs(y[i] - z[i]), 0, delta);
+      }
+    }
+  }
+
+  std::cout << "[N = 0]" << std::endl;
+  {
+    std::vector<double> x;
+    fast_walsh_hadamard<double>(x);
+    ASSERT_REAL(x.size(), 0, 0);
+  }
 
+  std::cout << "[batch]" << std::endl;
+  {
+    size_t N = 1024;
+    size_t count = 37;
+    size_t dist = N + 3;
+    std::vector<double> x(count * dist);
+    for(size_t i=0; i<x.size(); i++) {
+      x[i] = real_rand<double>();
+    }
+
+    std::vector<double> y = x;
+    fast_walsh_hadamard_batch(y.data(), N, count, dist, WhtNorm::none);
+
+    for(size_t v=0; v<count; v++) {
+      std::vector<double> ref(x.begin() + v*dist, x.begin() + v*dist + N);
+      walsh_hadamard_reference(ref);
+      for(size_t i=0; i<N; i++) {
+        ASSERT_REAL(std::abs(y[v*dist + i] - ref[i]), 0, 1e-6);
+      }
+      // Padding untouched
+      for(size_t i=N; i<dist; i++) {
+        ASSERT_REAL(std::abs(y[v*dist + i] - x[v*dist + i]), 0, 0);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,229 @@
+#include "huffman.hpp"
+#include "blockpack.hpp"
+#include "assert.hpp"
+
+// Decompressed data equal to the input
+void check_roundtrip(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> packed = huffman_compress(data.data(), data.size());
+  std::vector<uint8_t> out = huffman_decompress(packed.data(), packed.size());
+  ASSERT_REAL(std::abs((long)out.size() - (long)data.size()), 0, 0);
+  size_t errors = 0;
+  for(size_t i=0; i<data.size() && i<out.size(); i++)
+    errors += (out[i] != data[i]);
+  ASSERT_REAL(errors, 0, 0);
+}
+
+// Sum of 2^-length over the used symbols, times 2^15
+uint64_t kraft_sum(const std::vector<uint8_t>& lengths) {
+  uint64_t sum = 0;
+  for(uint8_t l : lengths)
+    if(l > 0)
+      sum += (uint64_t)1 << (HUFFMAN_MAX_BITS - l);
+  return sum;
+}
+
+int main() {
+  std::cout << "[bit writer and reader]" << std::endl;
+  {
+    std::vector<uint64_t> values(10000);
+    std::vector<size_t> widths(values.size());
+    BitWriter writer;
+    for(size_t i=0; i<values.size(); i++) {
+      widths[i] = 1 + rand() % 32;
+      values[i] = ((uint64_t)rand() << 16 ^ rand()) & (((uint64_t)1 << widths[i]) - 1);
+      writer.put(values[i], widths[i]);
+    }
+    size_t bits = writer.size_bits();
+    std::vector<uint8_t> bytes = writer.finish();
+    ASSERT_REAL(std::abs((long)bytes.size() - (long)(bits + 7) / 8), 0, 0);
+
+    BitReader reader(bytes.data(), bytes.size());
+    size_t errors = 0;
+    for(size_t i=0; i<values.size(); i++)
+      errors += (reader.get(widths[i]) != values[i]);
+    ASSERT_REAL(errors, 0, 0);
+    ASSERT_REAL(reader.overrun(), 0, 0);
+    reader.get(8);
+    ASSERT_REAL((!reader.overrun()), 0, 0);
+  }
+
+  std::cout << "[code lengths]" << std::endl;
+  {
+    // Complete code with the textbook lengths
+    std::vector<uint64_t> freq = { 5, 9, 12, 13, 16, 45 };
+    std::vector<uint8_t> lengths = huffman_code_lengths(freq.data(), freq.size());
+    std::vector<uint8_t> ref = { 4, 4, 3, 3, 3, 1 };
+    for(size_t s=0; s<ref.size(); s++)
+      ASSERT_REAL(std::abs(lengths[s] - ref[s]), 0, 0);
+
+    // Canonical: the codes of each length are consecutive, in symbol order
+    std::vector<uint32_t> codes = canonical_codes(lengths);
+    std::vector<uint32_t> ref_codes = { 0b1110, 0b1111, 0b100, 0b101, 0b110, 0b0 };
+    for(size_t s=0; s<ref.size(); s++)
+      ASSERT_REAL(std::abs((long)codes[s] - (long)reverse_bits(ref_codes[s], ref[s])), 0, 0);
+
+    // Fibonacci frequencies give a tree deeper than the limit
+    std::vector<uint64_t> fib(40);
+    fib[0] = fib[1] = 1;
+    for(size_t i=2; i<fib.size(); i++)
+      fib[i] = fib[i - 1] + fib[i - 2];
+    for(size_t max_bits : {15, 12, 6}) {
+      lengths = huffman_code_lengths(fib.data(), fib.size(), max_bits);
+      ASSERT_REAL(*std::max_element(lengths.begin(), lengths.end()), max_bits, 0);
+      ASSERT_REAL(std::abs((long)kraft_sum(lengths) - (1 << HUFFMAN_MAX_BITS)), 0, 0);
+    }
+  }
+
+  std::cout << "[length-limited codes]" << std::endl;
+  {
+    // With 3 bits the best code of 6 symbols is 2, 2, 3, 3, 3, 3
+    std::vector<uint64_t> freq = { 1, 2, 4, 8, 16, 32 };
+    std::vector<uint8_t> lengths = huffman_code_lengths(freq.data(), freq.size(), 3);
+    std::vector<uint8_t> ref = { 3, 3, 3, 3, 2, 2 };
+    for(size_t s=0; s<ref.size(); s++)
+      ASSERT_REAL(std::abs(lengths[s] - ref[s]), 0, 0);
+
+    // As many symbols as codes: all of the same length
+    freq.assign(64, 0);
+    for(size_t s=0; s<freq.size(); s++)
+      freq[s] = 1 + s * s * s;
+    lengths = huffman_code_lengths(freq.data(), freq.size(), 6);
+    for(size_t s=0; s<freq.size(); s++)
+      ASSERT_REAL(std::abs(lengths[s] - 6), 0, 0);
+
+    // Lower limits cost more bits, and the code stays complete
+    std::vector<uint64_t> fib(30);
+    fib[0] = fib[1] = 1;
+    for(size_t i=2; i<fib.size(); i++)
+      fib[i] = fib[i - 1] + fib[i - 2];
+    uint64_t previous = 0;
+    for(size_t max_bits=29; max_bits>=5; max_bits--) {
+      lengths = huffman_code_lengths(fib.data(), fib.size(), max_bits);
+      uint64_t cost = 0;
+      uint64_t kraft = 0;
+      for(size_t s=0; s<fib.size(); s++) {
+        cost += fib[s] * lengths[s];
+        kraft += (uint64_t)1 << (32 - lengths[s]);
+      }
+      ASSERT_REAL(*std::max_element(lengths.begin(), lengths.end()), max_bits, 0);
+      ASSERT_REAL(std::abs((long)kraft - (1l << 32)), 0, 0);
+      ASSERT_REAL((cost < previous), 0, 0);
+      previous = cost;
+    }
+
+    // A builder reused for blocks of any size gives the same codes as a new one
+    HuffmanBuilder builder;
+    std::vector<uint8_t> reused(256);
+    size_t errors = 0;
+    for(size_t block=0; block<20; block++) {
+      size_t n = 1 + rand() % 256;
+      freq.assign(n, 0);
+      for(size_t s=0; s<n; s++)
+        freq[s] = (rand() % 4 == 0) ? 0 : rand() % (1 << (rand() % 20));
+      size_t max_bits = 9 + rand() % 7;
+      builder.build(freq.data(), n, max_bits, reused.data());
+      lengths = huffman_code_lengths(freq.data(), n, max_bits);
+      for(size_t s=0; s<n; s++)
+        errors += (reused[s] != lengths[s]);
+    }
+    ASSERT_REAL(errors, 0, 0);
+  }
+
+  std::cout << "[roundtrips]" << std::endl;
+  {
+    check_roundtrip({});
+    check_roundtrip({42});
+    check_roundtrip(std::vector<uint8_t>(1000, 7));
+
+    // All the byte values
+    std::vector<uint8_t> data(100000);
+    for(size_t i=0; i<data.size(); i++)
+      data[i] = rand() % 256;
+    check_roundtrip(data);
+
+    // Skewed: codes longer than the first decoding table
+    for(size_t i=0; i<data.size(); i++) {
+      size_t s = 0;
+      while(s < 255 && rand() % 3 != 0)
+        s++;
+      data[i] = s;
+    }
+    std::vector<uint64_t> freq = byte_histogram(data.data(), data.size());
+    std::vector<uint8_t> lengths = huffman_code_lengths(freq.data(), 256);
+    ASSERT_REAL((*std::max_element(lengths.begin(), lengths.end()) <= HUFFMAN_TABLE_BITS), 0, 0);
+    check_roundtrip(data);
+
+    // Text: about 4.5 bits per letter
+    std::string text;
+    while(text.size() < 50000)
+      text += "the quick brown fox jumps over the lazy dog ";
+    data.assign(text.begin(), text.end());
+    std::vector<uint8_t> packed = huffman_compress(data.data(), data.size());
+    ASSERT_REAL(packed.size(), data.size() * 4.5 / 8, data.size() * 0.1 / 8);
+    check_roundtrip(data);
+  }
+
+  std::cout << "[histogram]" << std::endl;
+  {
+    // Runs, and a size that is not a multiple of 4
+    std::vector<uint8_t> data(10003);
+    for(size_t i=0; i<data.size(); i++)
+      data[i] = (i % 100 < 50) ? 9 : rand() % 256;
+    std::vector<uint64_t> ref(256, 0);
+    for(uint8_t v : data)
+      ref[v]++;
+    std::vector<uint64_t> freq = byte_histogram(data.data(), data.size());
+    size_t errors = 0;
+    for(size_t s=0; s<256; s++)
+      errors += (freq[s] != ref[s]);
+    ASSERT_REAL(errors, 0, 0);
+  }
+
+  std::cout << "[block container]" << std::endl;
+  {
+    // Text, then random bytes that are stored as is
+    std::string text;
+    while(text.size() < 300000)
+      text += "the quick brown fox jumps over the lazy dog " + std::to_string(text.size()) + " ";
+    std::vector<uint8_t> data(text.begin(), text.end());
+    for(size_t i=0; i<50000; i++)
+      data.push_back(rand() % 256);
+
+    for(size_t block_size : {1000, 65536, 1 << 20}) {
+      for(size_t threads : {1, 3}) {
+        std::vector<uint8_t> packed = blockpack_compress(data.data(), data.size(), block_size, threads);
+        BlockPackReader reader(packed.data(), packed.size());
+        ASSERT_REAL(std::abs((long)reader.num_blocks() - (long)((data.size() + block_size - 1) / block_size)), 0, 0);
+        std::vector<uint8_t> out = reader.read_all(threads);
+        ASSERT_REAL((out != data), 0, 0);
+        // The text gets smaller, the random bytes about the same size
+        size_t bound = 300000 * 0.9 + 50000 * 1.01;
+        ASSERT_REAL((packed.size() > bound), 0, 0);
+      }
+    }
+
+    // Ranges inside a block, across blocks, and at the end
+    std::vector<uint8_t> packed = blockpack_compress(data.data(), data.size(), 4096, 2);
+    BlockPackReader reader(packed.data(), packed.size());
+    size_t errors = 0;
+    for(size_t k=0; k<50; k++) {
+      size_t first = rand() % data.size();
+      size_t length = rand() % std::min<size_t>(20000, data.size() - first + 1);
+      if(k == 0) {
+        first = data.size() - 100;
+        length = 100;
+      }
+      std::vector<uint8_t> out(length);
+      reader.read(first, length, out.data(), 2);
+      errors += !std::equal(out.begin(), out.end(), data.begin() + first);
+    }
+    ASSERT_REAL(errors, 0, 0);
+
+    // Nothing to compress
+    packed = blockpack_compress(data.data(), 0);
+    ASSERT_REAL(std::abs((long)packed.size() - (long)BLOCKPACK_HEADER), 0, 0);
+    ASSERT_REAL(BlockPackReader(packed.data(), packed.size()).size(), 0, 0);
+  }
+
+  return 0;
+}
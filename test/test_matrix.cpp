@@ -0,0 +1,317 @@
+#include "kronecker.hpp"
+#include "structured.hpp"
+#include "assert.hpp"
+#include "random.hpp"
+
+template <typename T>
+Matrix<T> matrix_rand(size_t rows, size_t cols) {
+  Matrix<T> A(rows, cols);
+  for(size_t r=0; r<rows; r++)
+    for(size_t c=0; c<cols; c++)
+      A.set(r, c, real_rand<T>());
+  return A;
+}
+
+template <typename T>
+void test_kronecker_operator() {
+  T delta = get_delta<T>();
+
+  std::vector<std::vector<size_t>> shapes = {
+    {2, 2},
+    {3, 2, 1, 4},
+    {2, 3, 4, 1, 2, 5},
+  };
+
+  for(size_t s=0; s<shapes.size(); s++) {
+    std::cout << "[" << shapes[s].size() / 2 << " factors]" << std::endl;
+
+    KroneckerOperator<T> op;
+    std::vector<Matrix<T>> factors;
+    for(size_t i=0; i<shapes[s].size(); i+=2) {
+      factors.push_back(matrix_rand<T>(shapes[s][i], shapes[s][i+1]));
+      op.push_back(factors.back());
+    }
+
+    // Materialized reference
+    Matrix<T> K = factors[0];
+    for(size_t i=1; i<factors.size(); i++)
+      K = kronecker(K, factors[i]);
+
+    // Operator applied to one vector
+    std::vector<T> x(op.c());
+    for(size_t i=0; i<x.size(); i++)
+      x[i] = real_rand<T>();
+    std::vector<T> y_ref = K * x;
+    std::vector<T> y = op * x;
+    for(size_t i=0; i<y.size(); i++)
+      ASSERT_REAL(std::abs(y[i] - y_ref[i]), 0, delta * std::abs(y_ref[i]));
+
+    // Batched application
+    size_t count = 5;
+    std::vector<T> xb(count * op.c());
+    for(size_t i=0; i<xb.size(); i++)
+      xb[i] = real_rand<T>();
+    std::vector<T> yb(count * op.r());
+    op.apply(xb.data(), yb.data(), count);
+    for(size_t b=0; b<count; b++) {
+      std::vector<T> xi(xb.begin() + b*op.c(), xb.begin() + (b+1)*op.c());
+      std::vector<T> yi = K * xi;
+      for(size_t i=0; i<yi.size(); i++)
+        ASSERT_REAL(std::abs(yb[b*op.r() + i] - yi[i]), 0, delta * std::abs(yi[i]));
+    }
+
+    // Dense form
+    Matrix<T> D = op.dense();
+    for(size_t r=0; r<K.r(); r++)
+      for(size_t c=0; c<K.c(); c++)
+        ASSERT_REAL(std::abs(D.get(r, c) - K.get(r, c)), 0, delta * std::abs(K.get(r, c)));
+  }
+}
+
+template <typename T>
+void test_gemm() {
+  T delta = get_delta<T>();
+
+  std::vector<std::vector<size_t>> sizes = {
+    {3, 5, 7},
+    {67, 129, 300},  // more than one KC block, partial register blocks
+    {300, 200, 260}, // large enough for the threads
+  };
+
+  for(size_t s=0; s<sizes.size(); s++) {
+    size_t M = sizes[s][0];
+    size_t N = sizes[s][1];
+    size_t K = sizes[s][2];
+
+    std::cout << "[" << M << " x " << K << " * " << K << " x " << N << "]" << std::endl;
+
+    Matrix<T> A = matrix_rand<T>(M, K);
+    Matrix<T> B = matrix_rand<T>(K, N);
+
+    // Naive reference
+    std::vector<T> ref(M * N, 0);
+    for(size_t i=0; i<M; i++)
+      for(size_t j=0; j<N; j++)
+        for(size_t k=0; k<K; k++)
+          ref[i*N + j] += A.get(i, k) * B.get(k, j);
+
+    Matrix<T> C = A * B;
+    for(size_t i=0; i<M; i++)
+      for(size_t j=0; j<N; j++)
+        ASSERT_REAL(std::abs(C(i, j) - ref[i*N + j]), 0, delta * std::abs(ref[i*N + j]));
+
+    // Same product with B^T stored row-major and C stored column-major
+    Matrix<T> Bt(N, K);
+    for(size_t k=0; k<K; k++)
+      for(size_t j=0; j<N; j++)
+        Bt(j, k) = B(k, j);
+    std::vector<T> Ccm(M * N, 1);
+    gemm<T>(M, N, K, A.data(), K, 1, Bt.data(), 1, K, Ccm.data(), 1, M, T(2));
+    for(size_t i=0; i<M; i++)
+      for(size_t j=0; j<N; j++)
+        ASSERT_REAL(std::abs(Ccm[j*M + i] - (ref[i*N + j] + 2)), 0, delta * std::abs(ref[i*N + j]));
+
+    // Matrix-vector product, row-major and transposed
+    std::vector<T> x(K);
+    for(size_t k=0; k<K; k++)
+      x[k] = real_rand<T>();
+    std::vector<T> y = A * x;
+    std::vector<T> z(N);
+    gemv<T>(N, K, Bt.data(), K, 1, x.data(), z.data());
+    std::vector<T> zt(N);
+    gemv<T>(N, K, B.data(), 1, N, x.data(), zt.data());
+    for(size_t i=0; i<M; i++) {
+      T y_ref = 0;
+      for(size_t k=0; k<K; k++)
+        y_ref += A(i, k) * x[k];
+      ASSERT_REAL(std::abs(y[i] - y_ref), 0, delta * std::abs(y_ref));
+    }
+    for(size_t j=0; j<N; j++)
+      ASSERT_REAL(std::abs(z[j] - zt[j]), 0, delta * std::abs(z[j]));
+  }
+}
+
+template <typename T>
+void test_expressions() {
+  T delta = get_delta<T>();
+  size_t R = 17;
+  size_t C = 23;
+
+  Matrix<T> A = matrix_rand<T>(R, C);
+  Matrix<T> B = matrix_rand<T>(R, C);
+  Matrix<T> D = matrix_rand<T>(R, C);
+
+  // Fused evaluation
+  Matrix<T> E = A * T(2) + (B - D) / T(4) + T(3) * D;
+  for(size_t r=0; r<R; r++)
+    for(size_t c=0; c<C; c++) {
+      T ref = A(r, c) * 2 + (B(r, c) - D(r, c)) / 4 + 3 * D(r, c);
+      ASSERT_REAL(std::abs(E(r, c) - ref), 0, delta * std::abs(ref));
+    }
+
+  // In-place evaluation with the destination among the operands
+  Matrix<T> F = A;
+  F = F * T(0.5) + B;
+  F -= B;
+  F *= T(2);
+  for(size_t r=0; r<R; r++)
+    for(size_t c=0; c<C; c++)
+      ASSERT_REAL(std::abs(F(r, c) - A(r, c)), 0, delta * std::abs(A(r, c)));
+
+  // Vectors
+  std::vector<T> x(C), z(C);
+  for(size_t i=0; i<C; i++) {
+    x[i] = real_rand<T>();
+    z[i] = real_rand<T>();
+  }
+  std::vector<T> y;
+  assign(y, vec(x) * T(3) - vec(z));
+  for(size_t i=0; i<C; i++)
+    ASSERT_REAL(std::abs(y[i] - (3 * x[i] - z[i])), 0, delta * std::abs(y[i]));
+
+  // Move assignment steals the buffer
+  Matrix<T> G(1, 1);
+  const T* p = E.data();
+  G = std::move(E);
+  if(G.data() != p || G.r() != R || G.c() != C)
+    std::cerr << "Assert failed: move assignment did not move the buffer" << std::endl;
+}
+
+template <typename T>
+void check_structured(const std::vector<T>& y, const Matrix<T>& D, const std::vector<T>& x) {
+  std::vector<T> y_ref = D * x;
+  T delta = get_delta<T>();
+  T norm = 0;
+  for(size_t i=0; i<y_ref.size(); i++)
+    norm = std::max(norm, std::abs(y_ref[i]));
+  for(size_t i=0; i<y_ref.size(); i++)
+    ASSERT_REAL(std::abs(y[i] - y_ref[i]), 0, delta * norm);
+}
+
+template <typename T>
+void test_structured() {
+  std::vector<size_t> sizes = {1, 13, 16, 100};
+  for(size_t s=0; s<sizes.size(); s++) {
+    size_t n = sizes[s];
+    std::cout << "[circulant " << n << "]" << std::endl;
+
+    std::vector<T> col(n), x(n);
+    for(size_t i=0; i<n; i++) {
+      col[i] = real_rand<T>();
+      x[i] = real_rand<T>();
+    }
+    Circulant<T> C(col);
+    check_structured(C * x, C.dense(), x);
+    // Second product with the cached kernel spectrum
+    check_structured(C * col, C.dense(), col);
+  }
+
+  std::vector<std::vector<size_t>> shapes = {{1, 1}, {7, 12}, {100, 37}, {64, 64}};
+  for(size_t s=0; s<shapes.size(); s++) {
+    size_t m = shapes[s][0];
+    size_t n = shapes[s][1];
+    std::cout << "[toeplitz " << m << " x " << n << "]" << std::endl;
+
+    std::vector<T> col(m), row(n), x(n);
+    for(size_t i=0; i<m; i++)
+      col[i] = real_rand<T>();
+    for(size_t j=0; j<n; j++) {
+      row[j] = real_rand<T>();
+      x[j] = real_rand<T>();
+    }
+    row[0] = col[0];
+    Toeplitz<T> A(col, row);
+    check_structured(A * x, A.dense(), x);
+  }
+}
+
+template <typename T>
+void test_views() {
+  T delta = get_delta<T>();
+
+  // Big matrix holding the operands as sub-blocks
+  Matrix<T> Big = matrix_rand<T>(150, 160);
+  ConstMatrixView<T> A = Big.view().sub(3, 5, 70, 90);  // 70 x 90
+  ConstMatrixView<T> Bt = Big.view().sub(80, 7, 60, 90); // 60 x 90, used transposed
+
+  // Product written in a sub-block of another matrix
+  Matrix<T> Out(100, 100);
+  Out = Out * T(0);
+  MatrixView<T> C = Out.view().sub(10, 20, 70, 60);
+  gemm(A, Bt.t(), C);
+
+  for(size_t i=0; i<70; i++) {
+    for(size_t j=0; j<60; j++) {
+      T ref = 0;
+      for(size_t k=0; k<90; k++)
+        ref += Big(3 + i, 5 + k) * Big(80 + j, 7 + k);
+      ASSERT_REAL(std::abs(Out(10 + i, 20 + j) - ref), 0, delta * ref);
+    }
+  }
+  ASSERT_REAL(std::abs(Out(9, 20)), 0, 0);
+  ASSERT_REAL(std::abs(Out(10, 80)), 0, 0);
+
+  // Kronecker product of two views in a view
+  ConstMatrixView<T> K1 = Big.view().sub(0, 0, 3, 2);
+  ConstMatrixView<T> K2 = Big.view().sub(5, 5, 4, 5).t(); // 5 x 4
+  Matrix<T> K(40, 40);
+  kronecker(K1, K2, K.view().sub(1, 2, 15, 8));
+  for(size_t r=0; r<15; r++)
+    for(size_t c=0; c<8; c++)
+      ASSERT_REAL(std::abs(K(1 + r, 2 + c) - K1(r / 5, c / 4) * K2(r % 5, c % 4)), 0, 0);
+
+  // Expressions through views: row 2 = row 0 + 2 * row 1
+  Matrix<T> D = matrix_rand<T>(3, 8);
+  D.view().row(2) = D.view().row(0) + D.view().row(1) * T(2);
+  for(size_t c=0; c<8; c++)
+    ASSERT_REAL(std::abs(D(2, c) - (D(0, c) + 2 * D(1, c))), 0, delta * D(2, c));
+
+  // Views of the assigned matrix: transposed, smaller, shifted
+  Matrix<T> E = matrix_rand<T>(5, 5);
+  Matrix<T> ref = E;
+  E = E.view().t();
+  for(size_t r=0; r<5; r++)
+    for(size_t c=0; c<5; c++)
+      ASSERT_REAL(std::abs(E(r, c) - ref(c, r)), 0, 0);
+  E += E.view().t();
+  for(size_t r=0; r<5; r++)
+    for(size_t c=0; c<5; c++)
+      ASSERT_REAL(std::abs(E(r, c) - (ref(c, r) + ref(r, c))), 0, delta);
+  E = ref;
+  E = E.view().sub(1, 1, 2, 3);
+  ASSERT_REAL(std::abs((long)E.r() - 2), 0, 0);
+  ASSERT_REAL(std::abs((long)E.c() - 3), 0, 0);
+  for(size_t r=0; r<2; r++)
+    for(size_t c=0; c<3; c++)
+      ASSERT_REAL(std::abs(E(r, c) - ref(1 + r, 1 + c)), 0, 0);
+  E = ref;
+  E.view().sub(0, 1, 5, 4) = E.view().sub(0, 0, 5, 4);
+  for(size_t r=0; r<5; r++)
+    for(size_t c=1; c<5; c++)
+      ASSERT_REAL(std::abs(E(r, c) - ref(r, c - 1)), 0, 0);
+}
+
+int main() {
+  std::cout << "== Views double ==" << std::endl;
+  test_views<double>();
+
+  std::cout << "== Structured double ==" << std::endl;
+  test_structured<double>();
+
+  std::cout << "== Expressions double ==" << std::endl;
+  test_expressions<double>();
+
+  std::cout << "== Expressions float ==" << std::endl;
+  test_expressions<float>();
+
+  std::cout << "== GEMM double ==" << std::endl;
+  test_gemm<double>();
+
+  std::cout << "== GEMM float ==" << std::endl;
+  test_gemm<float>();
+
+  std::cout << "== Kronecker operator double ==" << std::endl;
+  test_kronecker_operator<double>();
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+#include "netpbm.hpp"
+#include "strip.hpp"
+#include "assert.hpp"
+
+void write_file(const std::string& filename, const std::string& content) {
+  std::ofstream fs(filename, std::ios::binary);
+  fs.write(content.data(), content.size());
+}
+
+// Same raster bytes
+void check_raster(const netpbm& img, const std::vector<uint8_t>& ref) {
+  ASSERT_REAL(std::abs((long)img.get_bytes() - (long)ref.size()), 0, 0);
+  for(size_t i=0; i<ref.size() && i<img.get_bytes(); i++)
+    ASSERT_REAL(std::abs(img.data()[i] - ref[i]), 0, 0);
+}
+
+int main() {
+  std::cout << "[binary header with comments]" << std::endl;
+  {
+    std::vector<uint8_t> ref = {0, 10, 20, 30, 40, 250};
+    write_file("test_netpbm.pgm", std::string("P5\n# comment\n3 # width\n2\n255\n") + std::string(ref.begin(), ref.end()));
+    netpbm img;
+    img.decoder("test_netpbm.pgm");
+    ASSERT_REAL(std::abs(img.get_width() - 3), 0, 0);
+    ASSERT_REAL(std::abs(img.get_height() - 2), 0, 0);
+    check_raster(img, ref);
+  }
+
+  std::cout << "[plain formats]" << std::endl;
+  {
+    // 10 pixels per row: two bytes per P4 row, digits packed together on the second row
+    write_file("test_netpbm.pbm", "P1\n# comment\n10 2\n1 0 1 0 0 0 0 0 1 1\n0000000001\n");
+    netpbm img;
+    img.decoder("test_netpbm.pbm");
+    check_raster(img, {0b10100000, 0b11000000, 0b00000000, 0b01000000});
+
+    write_file("test_netpbm.pgm", "P2\n2 2\n# comment\n1000\n0 999\n1000 256\n");
+    img.decoder("test_netpbm.pgm");
+    ASSERT_REAL(std::abs((long)img.get_depth() - 2), 0, 0);
+    check_raster(img, {0, 0, 0x03, 0xE7, 0x03, 0xE8, 0x01, 0x00});
+
+    write_file("test_netpbm.ppm", "P3 1 2 255 1 2 3 # comment\n 4 5 6\n");
+    img.decoder("test_netpbm.ppm");
+    check_raster(img, {1, 2, 3, 4, 5, 6});
+  }
+
+  std::cout << "[plain writer]" << std::endl;
+  {
+    // Large enough to be parsed and written in several chunks, with 16-bit samples
+    int width = 301;
+    int height = 257;
+    std::vector<uint8_t> raster(6 * width * height);
+    for(size_t i=0; i<raster.size(); i++)
+      raster[i] = rand() % 256;
+    netpbm img("P6", width, height, 65535, raster.data());
+    img.encoder("test_netpbm", "ppm", false, true);
+    img.encoder("test_netpbm", "pbm", false, true);
+
+    netpbm ppm;
+    ppm.decoder("test_netpbm.ppm");
+    check_raster(ppm, raster);
+
+    // Binary pbm of the same image for reference
+    netpbm pbm;
+    pbm.decoder("test_netpbm.pbm");
+    img.encoder("test_netpbm_ref", "pbm");
+    netpbm ref;
+    ref.decoder("test_netpbm_ref.pbm");
+    check_raster(pbm, std::vector<uint8_t>(ref.data(), ref.data() + ref.get_bytes()));
+
+    // No line is longer than 70 characters
+    for(std::string name : {"test_netpbm.ppm", "test_netpbm.pbm"}) {
+      std::ifstream fs(name);
+      std::string line;
+      size_t longest = 0;
+      while(getline(fs, line))
+        longest = std::max(longest, line.size());
+      ASSERT_REAL((longest > 70), 0, 0);
+    }
+
+    // Comments in the raster, on their own lines or after samples
+    std::string text = "P2\n3 2000\n255\n";
+    std::vector<uint8_t> gray(3 * 2000);
+    for(size_t i=0; i<gray.size(); i++) {
+      gray[i] = rand() % 256;
+      text += std::to_string(gray[i]) + ((i % 3 == 2) ? " # row\n" : " ");
+      if(i % 100 == 99)
+        text += "# comment 1 2 3\n";
+    }
+    write_file("test_netpbm.pgm", text);
+    netpbm pgm;
+    pgm.decoder("test_netpbm.pgm");
+    check_raster(pgm, gray);
+  }
+
+  std::cout << "[16-bit RGB]" << std::endl;
+  {
+    // Odd width: P4 rows are padded
+    int width = 13;
+    int height = 5;
+    int max = 1000;
+    std::vector<uint16_t> rgb(3 * width * height);
+    std::vector<uint8_t> raster(2 * rgb.size());
+    for(size_t i=0; i<rgb.size(); i++) {
+      rgb[i] = rand() % (max + 1);
+      raster[2*i] = rgb[i] >> 8;
+      raster[2*i + 1] = rgb[i] & 0xFF;
+    }
+
+    netpbm img("P6", width, height, max, raster.data());
+    img.encoder("test_netpbm", "ppm");
+    img.encoder("test_netpbm", "pgm");
+    img.encoder("test_netpbm", "pbm");
+
+    netpbm ppm;
+    ppm.decoder("test_netpbm.ppm");
+    ASSERT_REAL(std::abs(ppm.get_max() - max), 0, 0);
+    check_raster(ppm, raster);
+
+    std::vector<uint8_t> gray(2 * width * height);
+    std::vector<uint8_t> baw((width + 7) / 8 * height, 0);
+    for(int r=0; r<height; r++) {
+      for(int c=0; c<width; c++) {
+        size_t i = r * width + c;
+        uint16_t g = rgb_to_grayscale(rgb[3*i], rgb[3*i + 1], rgb[3*i + 2]);
+        gray[2*i] = g >> 8;
+        gray[2*i + 1] = g & 0xFF;
+        if(g < (max + 1) / 2)
+          baw[r * ((width + 7) / 8) + c / 8] |= 0x80 >> (c % 8);
+      }
+    }
+
+    netpbm pgm;
+    pgm.decoder("test_netpbm.pgm");
+    check_raster(pgm, gray);
+
+    netpbm pbm;
+    pbm.decoder("test_netpbm.pbm");
+    ASSERT_REAL(std::abs(pbm.get_width() - width), 0, 0);
+    check_raster(pbm, baw);
+
+    // Images can be moved
+    netpbm moved = std::move(pgm);
+    check_raster(moved, gray);
+
+    // Written over the file its raster is mapped from
+    ppm.encoder("test_netpbm", "ppm");
+    check_raster(ppm, raster);
+    netpbm again;
+    again.decoder("test_netpbm.ppm");
+    check_raster(again, raster);
+  }
+
+  std::cout << "[pixel kernels]" << std::endl;
+  {
+    // Large enough for several strips
+    size_t width = 333;
+    size_t height = 301;
+    std::vector<uint8_t> rgb(3 * width * height);
+    for(size_t i=0; i<rgb.size(); i++)
+      rgb[i] = rand() % 256;
+
+    std::vector<uint8_t> gray(width * height);
+    std::vector<uint8_t> gray1(width * height);
+    rgb_to_gray(rgb.data(), gray.data(), width, height, 1);
+    rgb_to_gray(rgb.data(), gray1.data(), width, height, 1, 1);
+    for(size_t i=0; i<width*height; i++) {
+      // Within one level of the floating point formula
+      double ref = 0.299 * rgb[3*i] + 0.587 * rgb[3*i + 1] + 0.114 * rgb[3*i + 2];
+      ASSERT_REAL(std::abs(gray[i] - ref), 0, 1);
+      ASSERT_REAL(std::abs(gray[i] - gray1[i]), 0, 0);
+    }
+
+    size_t row_bytes = (width + 7) / 8;
+    std::vector<uint8_t> bits(row_bytes * height);
+    binarize(gray.data(), bits.data(), width, height, 1, 100);
+    for(size_t r=0; r<height; r++) {
+      for(size_t c=0; c<row_bytes*8; c++) {
+        int bit = (bits[r*row_bytes + c/8] >> (7 - c%8)) & 1;
+        int ref = (c < width) ? (gray[r*width + c] < 100) : 0;
+        ASSERT_REAL(std::abs(bit - ref), 0, 0);
+      }
+    }
+
+    // Dithered flat gray: the share of white pixels follows the level
+    std::vector<uint8_t> flat(width * height, 64);
+    dither(flat.data(), bits.data(), width, height, 1, 255);
+    size_t white = 0;
+    for(size_t r=0; r<height; r++)
+      for(size_t c=0; c<width; c++)
+        white += 1 - ((bits[r*row_bytes + c/8] >> (7 - c%8)) & 1);
+    ASSERT_REAL(std::abs((double)white / (width * height) - 64.0 / 255), 0, 0.01);
+  }
+
+  std::cout << "[strip pipeline]" << std::endl;
+  {
+    size_t width = 37;
+    size_t height = 50;
+    std::vector<uint8_t> rgb(3 * width * height);
+    for(size_t i=0; i<rgb.size(); i++)
+      rgb[i] = rand() % 256;
+    netpbm img("P6", width, height, 255, rgb.data());
+    img.encoder("test_netpbm", "ppm");
+
+    std::vector<uint8_t> gray(width * height);
+    rgb_to_gray(rgb.data(), gray.data(), width, height, 1);
+
+    // Reference 3x3 mean with repeated borders
+    std::vector<uint8_t> blur(width * height);
+    for(size_t r=0; r<height; r++) {
+      for(size_t c=0; c<width; c++) {
+        unsigned int sum = 0;
+        for(int dr=-1; dr<=1; dr++)
+          for(int dc=-1; dc<=1; dc++)
+            sum += gray[std::clamp<long>(r + dr, 0, height - 1) * width + std::clamp<long>(c + dc, 0, width - 1)];
+        blur[r*width + c] = (sum + 4) / 9;
+      }
+    }
+    std::vector<uint8_t> baw((width + 7) / 8 * height);
+    binarize(blur.data(), baw.data(), width, height, 1, 100);
+
+    // Strips that do not divide the height, and a single row
+    std::vector<size_t> strips = {7, 1, 64};
+    for(size_t k=0; k<strips.size(); k++) {
+      StripPipeline to_gray;
+      to_gray.add<GrayscaleStage>();
+      to_gray.run("test_netpbm.ppm", "test_netpbm.pgm", strips[k]);
+      netpbm pgm;
+      pgm.decoder("test_netpbm.pgm");
+      check_raster(pgm, gray);
+
+      StripPipeline to_baw;
+      to_baw.add<GrayscaleStage>().add<BoxFilterStage>().add<ThresholdStage>(100);
+      to_baw.run("test_netpbm.ppm", "test_netpbm.pbm", strips[k]);
+      netpbm pbm;
+      pbm.decoder("test_netpbm.pbm");
+      check_raster(pbm, baw);
+    }
+  }
+
+  remove("test_netpbm.pbm");
+  remove("test_netpbm.pgm");
+  remove("test_netpbm.ppm");
+  remove("test_netpbm_ref.pbm");
+
+  return 0;
+}
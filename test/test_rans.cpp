@@ -0,0 +1,104 @@
+#include <cmath>
+
+#include "rans.hpp"
+#include "huffman.hpp"
+#include "assert.hpp"
+
+// Decompressed data equal to the input
+void check_roundtrip(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> packed = rans_compress(data.data(), data.size());
+  std::vector<uint8_t> out = rans_decompress(packed.data(), packed.size());
+  ASSERT_REAL(std::abs((long)out.size() - (long)data.size()), 0, 0);
+  ASSERT_REAL((out != data), 0, 0);
+}
+
+double entropy_bytes(const std::vector<uint8_t>& data) {
+  std::vector<uint64_t> freq = byte_histogram(data.data(), data.size());
+  double bits = 0;
+  for(uint64_t f : freq)
+    if(f > 0)
+      bits -= f * std::log2((double)f / data.size());
+  return bits / 8;
+}
+
+int main() {
+  const uint32_t M = (uint32_t)1 << RANS_PROB_BITS;
+
+  std::cout << "[normalized frequencies]" << std::endl;
+  {
+    // Sum of M, used symbols kept, proportions close
+    std::vector<uint64_t> freq(256, 0);
+    for(size_t s=0; s<256; s+=3)
+      freq[s] = (s < 10) ? 100000 + rand() % 100000 : 1 + rand() % 50;
+    std::vector<uint32_t> norm(256);
+    normalize_frequencies(freq.data(), 256, RANS_PROB_BITS, norm.data());
+    uint64_t sum = 0;
+    size_t lost = 0;
+    for(size_t s=0; s<256; s++) {
+      sum += norm[s];
+      lost += (freq[s] > 0) != (norm[s] > 0);
+    }
+    ASSERT_REAL(std::abs((long)sum - (long)M), 0, 0);
+    ASSERT_REAL(lost, 0, 0);
+
+    // Exact when the frequencies already sum to M
+    freq.assign(256, 0);
+    freq[7] = M / 2;
+    freq[8] = M / 4;
+    freq[200] = M / 4;
+    normalize_frequencies(freq.data(), 256, RANS_PROB_BITS, norm.data());
+    for(size_t s=0; s<256; s++)
+      ASSERT_REAL(std::abs((long)norm[s] - (long)freq[s]), 0, 0);
+
+    // As many symbols as slots: 1 each
+    freq.assign(256, 0);
+    freq[0] = 1000000;
+    for(size_t s=1; s<256; s++)
+      freq[s] = 1;
+    normalize_frequencies(freq.data(), 256, 8, norm.data());
+    for(size_t s=0; s<256; s++)
+      ASSERT_REAL(std::abs((long)norm[s] - 1), 0, 0);
+  }
+
+  std::cout << "[roundtrips]" << std::endl;
+  {
+    check_roundtrip({});
+    check_roundtrip({42});
+    // Sizes around a group of lanes
+    for(size_t n=RANS_LANES-1; n<=2*RANS_LANES+1; n++) {
+      std::vector<uint8_t> data(n);
+      for(auto& v : data)
+        v = rand() % 4;
+      check_roundtrip(data);
+    }
+    // A single symbol: no word besides the states
+    std::vector<uint8_t> data(10000, 7);
+    check_roundtrip(data);
+    size_t expected = 8 + 2 * 256 + 4 * RANS_LANES;
+    ASSERT_REAL(std::abs((long)rans_compress(data.data(), data.size()).size() - (long)expected), 0, 0);
+
+    // All the byte values, and one symbol of frequency 1
+    data.resize(100000);
+    for(auto& v : data)
+      v = rand() % 255;
+    data[5000] = 255;
+    check_roundtrip(data);
+  }
+
+  std::cout << "[skewed data]" << std::endl;
+  {
+    // One symbol of probability 0.9: Huffman needs 1 bit per symbol, rANS
+    // gets close to the entropy of about 0.57 bit
+    std::vector<uint8_t> data(200000);
+    for(auto& v : data)
+      v = (rand() % 10 == 0) ? 1 + rand() % 8 : 0;
+    double entropy = entropy_bytes(data);
+    std::vector<uint8_t> packed = rans_compress(data.data(), data.size());
+    std::vector<uint8_t> huff = huffman_compress(data.data(), data.size());
+    ASSERT_REAL(packed.size(), entropy, entropy * 0.01 + 600);
+    ASSERT_REAL(packed.size(), huff.size() * 0.85, 0);
+    check_roundtrip(data);
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include "resample.hpp"
+#include "assert.hpp"
+
+// Largest difference between the samples of two rasters of depth bytes
+uint32_t max_diff(const uint8_t* a, const uint8_t* b, size_t n, size_t depth) {
+  uint32_t d = 0;
+  for(size_t i=0; i<n; i++) {
+    uint32_t x = (depth == 1) ? load_sample<1>(a, i) : load_sample<2>(a, i);
+    uint32_t y = (depth == 1) ? load_sample<1>(b, i) : load_sample<2>(b, i);
+    d = std::max(d, (x > y) ? x - y : y - x);
+  }
+  return d;
+}
+
+int main() {
+  std::vector<ResampleFilter> filters = {ResampleFilter::box, ResampleFilter::bicubic, ResampleFilter::lanczos3};
+  std::vector<std::string> names = {"box", "bicubic", "lanczos3"};
+
+  for(size_t f=0; f<filters.size(); f++) {
+    std::cout << "[" << names[f] << "]" << std::endl;
+
+    std::cout << " Same size" << std::endl;
+    {
+      size_t width = 37;
+      size_t height = 23;
+      std::vector<uint8_t> rgb(6 * width * height);
+      for(size_t i=0; i<rgb.size(); i++)
+        rgb[i] = rand() % 256;
+      netpbm img("P6", width, height, 65535, rgb.data());
+      netpbm out = resize(img, width, height, filters[f]);
+      ASSERT_REAL(max_diff(out.data(), rgb.data(), 3 * width * height, 2), 0, 0);
+    }
+
+    std::cout << " Flat image" << std::endl;
+    {
+      std::vector<uint8_t> gray(300 * 200, 77);
+      netpbm img("P5", 300, 200, 255, gray.data());
+      std::vector<std::vector<size_t>> sizes = {{100, 67}, {7, 3}, {641, 401}, {1, 1}};
+      for(auto& s : sizes) {
+        netpbm out = resize(img, s[0], s[1], filters[f]);
+        ASSERT_REAL(std::abs(out.get_width() - (int)s[0]) + std::abs(out.get_height() - (int)s[1]), 0, 0);
+        std::vector<uint8_t> flat(s[0] * s[1], 77);
+        ASSERT_REAL(max_diff(out.data(), flat.data(), flat.size(), 1), 0, 0);
+      }
+    }
+  }
+
+  std::cout << "[box halving]" << std::endl;
+  {
+    // Mean of 2 x 2 blocks
+    size_t width = 64;
+    size_t height = 48;
+    std::vector<uint8_t> gray(width * height);
+    for(size_t i=0; i<gray.size(); i++)
+      gray[i] = rand() % 256;
+    netpbm img("P5", width, height, 255, gray.data());
+    netpbm out = resize(img, width / 2, height / 2, ResampleFilter::box);
+    std::vector<uint8_t> ref(width * height / 4);
+    for(size_t r=0; r<height/2; r++) {
+      for(size_t c=0; c<width/2; c++) {
+        uint32_t sum = gray[2*r*width + 2*c] + gray[2*r*width + 2*c + 1] + gray[(2*r + 1)*width + 2*c] + gray[(2*r + 1)*width + 2*c + 1];
+        ref[r*width/2 + c] = (sum + 2) / 4;
+      }
+    }
+    // Within one level: the weights are rounded to float
+    ASSERT_REAL(max_diff(out.data(), ref.data(), ref.size(), 1), 0, 1);
+  }
+
+  std::cout << "[bicubic ramp]" << std::endl;
+  {
+    // The cubic filter reproduces linear ramps away from the borders
+    size_t width = 50;
+    std::vector<uint8_t> gray(width * 4);
+    for(size_t r=0; r<4; r++)
+      for(size_t c=0; c<width; c++)
+        gray[r*width + c] = 4 * c;
+    netpbm img("P5", width, 4, 255, gray.data());
+    netpbm out = resize(img, 2 * width, 4, ResampleFilter::bicubic);
+    for(size_t c=4; c<2*width-4; c++) {
+      double ref = 4 * ((c + 0.5) / 2 - 0.5);
+      ASSERT_REAL(std::abs(out.data()[c] - ref), 0, 0.5);
+    }
+  }
+
+  std::cout << "[pyramid]" << std::endl;
+  {
+    size_t width = 100;
+    size_t height = 37;
+    std::vector<uint8_t> rgb(3 * width * height);
+    for(size_t i=0; i<rgb.size(); i++)
+      rgb[i] = rand() % 256;
+    netpbm img("P6", width, height, 255, rgb.data());
+    std::vector<netpbm> pyramid = build_pyramid(img, 20);
+
+    // 50x19, 25x10, 13x5, 7x3, 4x2, 2x1, 1x1
+    std::vector<int> widths = {50, 25, 13, 7, 4, 2, 1};
+    std::vector<int> heights = {19, 10, 5, 3, 2, 1, 1};
+    ASSERT_REAL(std::abs((long)pyramid.size() - 7), 0, 0);
+    for(size_t l=0; l<pyramid.size() && l<widths.size(); l++)
+      ASSERT_REAL(std::abs(pyramid[l].get_width() - widths[l]) + std::abs(pyramid[l].get_height() - heights[l]), 0, 0);
+
+    netpbm level1 = resize(pyramid[0], 25, 10, ResampleFilter::box);
+    ASSERT_REAL(max_diff(level1.data(), pyramid[1].data(), level1.get_bytes(), 1), 0, 0);
+  }
+
+  return 0;
+}
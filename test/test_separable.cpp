@@ -0,0 +1,118 @@
+#include "dct.hpp"
+#include "fft.hpp"
+#include "hadamard.hpp"
+#include "assert.hpp"
+#include "random.hpp"
+
+int main() {
+  double delta = get_delta<double>();
+
+  std::vector<std::vector<size_t>> sizes = {
+    {8, 8, 8},
+    {16, 32, 40},    // stride > cols
+    {128, 256, 256}, // big enough to run on several threads
+  };
+
+  for(size_t s=0; s<sizes.size(); s++) {
+    size_t rows = sizes[s][0];
+    size_t cols = sizes[s][1];
+    size_t stride = sizes[s][2];
+
+    std::cout << "[" << rows << " x " << cols << ", stride " << stride << "]" << std::endl;
+
+    std::cout << " DCT-II 2D" << std::endl;
+    {
+      std::vector<double> x(rows * stride);
+      for(size_t i=0; i<x.size(); i++)
+        x[i] = real_rand<double>();
+
+      // Reference: rows, then columns one by one
+      std::vector<double> ref(rows * cols);
+      std::vector<double> line(std::max(rows, cols));
+      std::vector<double> out(std::max(rows, cols));
+      for(size_t r=0; r<rows; r++)
+        dctII(x.data() + r*stride, ref.data() + r*cols, cols);
+      for(size_t c=0; c<cols; c++) {
+        for(size_t r=0; r<rows; r++)
+          line[r] = ref[r*cols + c];
+        dctII(line.data(), out.data(), rows);
+        for(size_t r=0; r<rows; r++)
+          ref[r*cols + c] = out[r];
+      }
+
+      dctII_2D(x.data(), rows, cols, stride);
+
+      for(size_t r=0; r<rows; r++)
+        for(size_t c=0; c<cols; c++)
+          ASSERT_REAL(std::abs(x[r*stride + c] - ref[r*cols + c]), 0, delta * std::abs(ref[r*cols + c]) + delta);
+    }
+
+    std::cout << " FFT 2D" << std::endl;
+    if(cols == stride) {
+      std::vector<Cpx<double>> x(rows * cols);
+      for(size_t i=0; i<x.size(); i++)
+        x[i] = complex_rand<double>();
+
+      // Reference: 2D DFT computed directly
+      std::vector<Cpx<double>> ref(rows * cols);
+      for(size_t k=0; k<rows; k++) {
+        for(size_t l=0; l<cols; l++) {
+          if(rows > 16 && (k % 31 != 0 || l % 37 != 0))
+            continue; // only spot check large sizes
+          Cpx<double> acc;
+          for(size_t r=0; r<rows; r++)
+            for(size_t c=0; c<cols; c++)
+              acc += x[r*cols + c] * get_twiddle<double>(rows, k*r) * get_twiddle<double>(cols, l*c);
+          ref[k*cols + l] = acc;
+        }
+      }
+
+      std::vector<Cpx<double>> y = x;
+      fft_2D(y.data(), rows, cols, cols, 2, false);
+      for(size_t k=0; k<rows; k++)
+        for(size_t l=0; l<cols; l++)
+          if(rows <= 16 || (k % 31 == 0 && l % 37 == 0))
+            ASSERT(y[k*cols + l], ref[k*cols + l], delta * 1e3);
+
+      fft_2D(y.data(), rows, cols, cols, 2, true);
+      for(size_t i=0; i<x.size(); i++)
+        ASSERT(y[i], x[i], delta);
+    }
+
+    std::cout << " Walsh-Hadamard 2D" << std::endl;
+    {
+      std::vector<double> x(rows * stride);
+      for(size_t i=0; i<x.size(); i++)
+        x[i] = real_rand<double>();
+
+      // The normalized transform is an involution
+      std::vector<double> y = x;
+      fast_walsh_hadamard_2D(y.data(), rows, cols, stride);
+      fast_walsh_hadamard_2D(y.data(), rows, cols, stride);
+      for(size_t r=0; r<rows; r++)
+        for(size_t c=0; c<cols; c++)
+          ASSERT_REAL(std::abs(y[r*stride + c] - x[r*stride + c]), 0, delta);
+    }
+  }
+
+  std::cout << "[views]" << std::endl;
+  {
+    // DCT of a transposed sub-block = transpose of the DCT of the sub-block
+    size_t rows = 24;
+    size_t cols = 40;
+    Matrix<double> X(rows, cols);
+    for(size_t r=0; r<rows; r++)
+      for(size_t c=0; c<cols; c++)
+        X(r, c) = real_rand<double>();
+    Matrix<double> Y = X;
+
+    dctII_2D(X.view().sub(4, 8, 16, 32));
+    dctII_2D(Y.view().sub(4, 8, 16, 32).t());
+
+    for(size_t r=0; r<rows; r++)
+      for(size_t c=0; c<cols; c++)
+        ASSERT_REAL(std::abs(X(r, c) - Y(r, c)), 0, delta * (std::abs(X(r, c)) + 1));
+  }
+
+  return 0;
+}
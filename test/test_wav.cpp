@@ -0,0 +1,366 @@
+#include "wav.hpp"
+#include "assert.hpp"
+
+// Write a mono PCM file byte by byte, optionally with a LIST chunk before the data
+void write_test_wav(const std::string& filename, unsigned int bits, const std::vector<int>& x, bool list_chunk) {
+  WavHeader header;
+  init_wav_header(header, 1, 1, 8000, bits, x.size());
+
+  std::ofstream fs(filename, std::ios::binary);
+  if(!list_chunk) {
+    write_wav_header(fs, header);
+  }
+  else {
+    const char list[] = "LIST\x06\x00\x00\x00INFOab";
+    char size[4];
+    big_to_little_endian_4(header.chunk_size + sizeof(list) - 1, size);
+    fs.write(header.riff, 4);
+    fs.write(size, 4);
+    fs.write(header.wave, 4);
+    fs.write(header.subchunk1_id, 4);
+    fs.write(header.little_subchunk1_size, 4);
+    fs.write(header.little_audio_format, 2);
+    fs.write(header.little_num_channels, 2);
+    fs.write(header.little_sample_rate, 4);
+    fs.write(header.little_byte_rate, 4);
+    fs.write(header.little_block_align, 2);
+    fs.write(header.little_bits_per_sample, 2);
+    fs.write(list, sizeof(list) - 1);
+    fs.write(header.subchunk2_id, 4);
+    fs.write(header.little_subchunk2_size, 4);
+  }
+
+  for(size_t i=0; i<x.size(); i++) {
+    char b[4];
+    int v = (bits == 8) ? x[i] + 128 : x[i];
+    big_to_little_endian_4(v, b);
+    fs.write(b, bits / 8);
+  }
+}
+
+std::vector<int> random_samples(size_t n, unsigned int bits) {
+  std::vector<int> x(n);
+  long range = 1l << (bits - 1);
+  for(size_t i=0; i<n; i++) {
+    long r = ((long)rand() << 16) ^ rand();
+    x[i] = (int)(r % (2 * range) - range);
+  }
+  return x;
+}
+
+int main() {
+  const std::string filename = "test_wav.wav";
+  std::vector<unsigned int> bits = {8, 16, 32};
+
+  for(size_t b=0; b<bits.size(); b++) {
+    for(int list_chunk=0; list_chunk<2; list_chunk++) {
+      std::cout << "[" << bits[b] << " bits" << (list_chunk ? ", LIST chunk" : "") << "]" << std::endl;
+
+      size_t N = 1000;
+      std::vector<int> x = random_samples(N, bits[b]);
+      write_test_wav(filename, bits[b], x, list_chunk);
+
+      // Mapped file: converted range
+      WavMap wav(filename);
+      ASSERT_REAL(std::abs((long)wav.num_frames() - (long)N), 0, 0);
+      std::vector<double> y(N - 10);
+      wav.read(10, N - 10, y.data());
+      for(size_t i=0; i<N-10; i++)
+        ASSERT_REAL(std::abs(y[i] - x[10 + i]), 0, 0);
+
+      // Mapped file: samples in place
+      if(bits[b] == 16) {
+        std::span<const int16_t> s = wav.samples<int16_t>();
+        for(size_t i=0; i<N; i++)
+          ASSERT_REAL(std::abs(s[i] - x[i]), 0, 0);
+      }
+
+      // Stream reader
+      if(!list_chunk) {
+        std::ifstream fs(filename, std::ios::binary);
+        WavHeader header;
+        std::vector<double> z;
+        signal_from_wav_file(fs, header, z, true);
+        for(size_t i=0; i<N; i++)
+          ASSERT_REAL(std::abs(z[i] - x[i]), 0, 0);
+      }
+    }
+  }
+
+  for(size_t b=0; b<bits.size(); b++) {
+    std::cout << "[" << bits[b] << " bits, stream writer and reader]" << std::endl;
+
+    // Stereo, odd number of frames, buffers smaller than the file
+    size_t channels = 2;
+    size_t N = 1001;
+    std::vector<int> x = random_samples(N * channels, bits[b]);
+    {
+      WavWriter writer(filename, 1, channels, 8000, bits[b], 64);
+      std::vector<double> block(x.begin(), x.end());
+      for(size_t first=0; first<N; first+=100) {
+        size_t count = std::min<size_t>(100, N - first);
+        writer.write(block.data() + first * channels, count * channels);
+      }
+    }
+
+    WavReader reader(filename, 48);
+    ASSERT_REAL(std::abs((long)reader.num_frames() - (long)N), 0, 0);
+    std::vector<double> y(N * channels);
+    size_t got = 0;
+    size_t n;
+    while((n = reader.read(std::span<double>(y.data() + got * channels, std::min<size_t>(37, N - got) * channels))) > 0)
+      got += n;
+    ASSERT_REAL(std::abs((long)got - (long)N), 0, 0);
+    for(size_t i=0; i<N*channels; i++)
+      ASSERT_REAL(std::abs(y[i] - x[i]), 0, 0);
+
+    // The patched header is read back by the mapped reader too
+    WavMap wav(filename);
+    ASSERT_REAL(std::abs((long)wav.num_frames() - (long)N), 0, 0);
+  }
+
+  std::vector<size_t> channels = {2, 5};
+  for(size_t b=0; b<bits.size(); b++) {
+    for(size_t ch=0; ch<channels.size(); ch++) {
+      std::cout << "[" << bits[b] << " bits, " << channels[ch] << " channels, planar]" << std::endl;
+
+      // One buffer per channel, written in two calls
+      size_t C = channels[ch];
+      size_t N = 777;
+      std::vector<std::vector<double>> x(C);
+      std::vector<const double*> in(C);
+      for(size_t c=0; c<C; c++) {
+        std::vector<int> r = random_samples(N, bits[b]);
+        x[c].assign(r.begin(), r.end());
+      }
+      {
+        WavWriter writer(filename, 1, C, 8000, bits[b], 100);
+        for(size_t c=0; c<C; c++)
+          in[c] = x[c].data();
+        writer.write_planar(in.data(), 300);
+        for(size_t c=0; c<C; c++)
+          in[c] = x[c].data() + 300;
+        writer.write_planar(in.data(), N - 300);
+      }
+
+      // Interleaved on disk
+      WavMap wav(filename);
+      std::vector<double> y(N * C);
+      wav.read(0, N, y.data());
+      for(size_t i=0; i<N; i++)
+        for(size_t c=0; c<C; c++)
+          ASSERT_REAL(std::abs(y[i*C + c] - x[c][i]), 0, 0);
+
+      // Mapped planar read of a range, into one buffer with one channel after the other
+      std::vector<double> z(C * (N - 5));
+      std::vector<double*> out(C);
+      for(size_t c=0; c<C; c++)
+        out[c] = z.data() + c * (N - 5);
+      wav.read_planar(5, N - 5, out.data());
+      for(size_t c=0; c<C; c++)
+        for(size_t i=0; i<N-5; i++)
+          ASSERT_REAL(std::abs(out[c][i] - x[c][5 + i]), 0, 0);
+
+      // Stream planar read
+      WavReader reader(filename, 64);
+      std::vector<std::vector<double>> w(C, std::vector<double>(N));
+      for(size_t c=0; c<C; c++)
+        out[c] = w[c].data();
+      ASSERT_REAL(std::abs((long)reader.read_planar(out.data(), N + 10) - (long)N), 0, 0);
+      for(size_t c=0; c<C; c++)
+        for(size_t i=0; i<N; i++)
+          ASSERT_REAL(std::abs(w[c][i] - x[c][i]), 0, 0);
+
+      // Whole file
+      std::ifstream fs(filename, std::ios::binary);
+      WavHeader header;
+      std::vector<std::vector<double>> v;
+      signal_from_wav_file(fs, header, v);
+      ASSERT_REAL(std::abs((long)v.size() - (long)C), 0, 0);
+      for(size_t c=0; c<C; c++)
+        for(size_t i=0; i<N; i++)
+          ASSERT_REAL(std::abs(v[c][i] - x[c][i]), 0, 0);
+    }
+  }
+
+  std::vector<std::vector<unsigned int>> formats = {
+    {1, 8}, {1, 16}, {1, 24}, {1, 32}, {3, 32}, {3, 64}, {6, 8}, {7, 8}
+  };
+  for(size_t f=0; f<formats.size(); f++) {
+    std::cout << "[format " << formats[f][0] << ", " << formats[f][1] << " bits, normalized]" << std::endl;
+
+    // [-1, 1) in, scaled to the full range of the format and back
+    PcmFormat format = pcm_format(formats[f][0], formats[f][1]);
+    double full_scale = pcm_full_scale(format);
+    size_t N = 500;
+    std::vector<double> x(N);
+    for(size_t i=0; i<N; i++)
+      x[i] = 2.0 * rand() / ((double)RAND_MAX + 1) - 1;
+    {
+      WavWriter writer(filename, formats[f][0], 1, 8000, formats[f][1]);
+      writer.write(x.data(), N, full_scale);
+    }
+
+    double tol = 0;
+    if(format == PcmFormat::alaw || format == PcmFormat::mulaw)
+      tol = 1.0 / 32; // half the largest step
+    else if(format == PcmFormat::float32)
+      tol = 1e-7;
+    else if(pcm_is_integer(format))
+      tol = 1 / full_scale; // clipped at the top
+
+    WavMap wav(filename);
+    std::vector<double> y(N);
+    wav.read(0, N, y.data(), 1 / full_scale);
+    for(size_t i=0; i<N; i++)
+      ASSERT_REAL(std::abs(y[i] - x[i]), 0, tol);
+
+    std::ifstream fs(filename, std::ios::binary);
+    WavHeader header;
+    std::vector<double> z;
+    signal_from_wav_file(fs, header, z, true);
+    for(size_t i=0; i<N; i++)
+      ASSERT_REAL(std::abs(z[i] - y[i] * full_scale), 0, 0);
+  }
+
+  std::cout << "[G.711]" << std::endl;
+  for(int b=0; b<256; b++) {
+    // Decoded values are encoded back to the same level
+    int16_t a = alaw_to_linear(b);
+    int16_t u = mulaw_to_linear(b);
+    ASSERT_REAL(std::abs(alaw_to_linear(linear_to_alaw(a)) - a), 0, 0);
+    ASSERT_REAL(std::abs(mulaw_to_linear(linear_to_mulaw(u)) - u), 0, 0);
+  }
+
+  std::cout << "[WAVE_FORMAT_EXTENSIBLE]" << std::endl;
+  {
+    // 40-byte fmt chunk with an IEEE float sub-format, then a fact chunk
+    std::vector<float> x = {0.5f, -0.25f, 1.0f, -1.0f, 0.125f, 0.0f};
+    WavHeader header;
+    init_wav_header(header, 0xFFFE, 2, 8000, 32, x.size() / 2);
+    char fmt_size[4], riff_size[4], ext[24] = {};
+    big_to_little_endian_4(40, fmt_size);
+    big_to_little_endian_4(4 + 48 + 12 + 8 + x.size() * 4, riff_size);
+    ext[0] = 22;  // extension size
+    ext[2] = 32;  // valid bits
+    ext[4] = 3;   // channel mask
+    ext[8] = 3;   // sub-format GUID: IEEE float
+    {
+      std::ofstream fs(filename, std::ios::binary);
+      fs.write(header.riff, 4);
+      fs.write(riff_size, 4);
+      fs.write(header.wave, 4);
+      fs.write(header.subchunk1_id, 4);
+      fs.write(fmt_size, 4);
+      fs.write(header.little_audio_format, 2);
+      fs.write(header.little_num_channels, 2);
+      fs.write(header.little_sample_rate, 4);
+      fs.write(header.little_byte_rate, 4);
+      fs.write(header.little_block_align, 2);
+      fs.write(header.little_bits_per_sample, 2);
+      fs.write(ext, 24);
+      fs.write("fact\x04\x00\x00\x00\x03\x00\x00\x00", 12);
+      fs.write(header.subchunk2_id, 4);
+      fs.write(header.little_subchunk2_size, 4);
+      for(size_t i=0; i<x.size(); i++) {
+        char b[4];
+        big_to_little_endian_4(std::bit_cast<uint32_t>(x[i]), b);
+        fs.write(b, 4);
+      }
+    }
+
+    WavMap wav(filename);
+    std::vector<double> y(x.size());
+    wav.read(0, x.size() / 2, y.data());
+    for(size_t i=0; i<x.size(); i++)
+      ASSERT_REAL(std::abs(y[i] - x[i]), 0, 0);
+
+    WavReader reader(filename);
+    std::vector<double> l(3), r(3);
+    double* out[] = {l.data(), r.data()};
+    reader.read_planar(out, 3);
+    for(size_t i=0; i<3; i++) {
+      ASSERT_REAL(std::abs(l[i] - x[2*i]), 0, 0);
+      ASSERT_REAL(std::abs(r[i] - x[2*i + 1]), 0, 0);
+    }
+  }
+
+  std::cout << "[dither]" << std::endl;
+  {
+    // A constant below one LSB averages to itself only with dither
+    size_t N = 100000;
+    std::vector<double> x(N, 0.3);
+    {
+      WavWriter writer(filename, 1, 1, 8000, 16);
+      writer.set_dither(true);
+      writer.write(x.data(), N);
+    }
+    WavMap wav(filename);
+    std::vector<double> y(N);
+    wav.read(0, N, y.data());
+    double mean = 0;
+    for(size_t i=0; i<N; i++) {
+      ASSERT_REAL(std::abs(y[i] - 0.3), 0, 1.5);
+      mean += y[i] / N;
+    }
+    ASSERT_REAL(std::abs(mean - 0.3), 0, 0.02);
+  }
+
+  std::cout << "[async writer and reader]" << std::endl;
+  {
+    // Stereo, more blocks than slots, last block partial
+    size_t channels = 2;
+    size_t N = 10007;
+    std::vector<int> r = random_samples(N * channels, 16);
+    std::vector<double> x(r.begin(), r.end());
+    {
+      AsyncWavWriter<double> writer(filename, 1, channels, 8000, 16, 512);
+      // Filling the ring blocks in place...
+      size_t first = 0;
+      for(int b=0; b<5; b++) {
+        std::span<double> block = writer.buffer();
+        std::copy(x.begin() + first * channels, x.begin() + (first + 300) * channels, block.begin());
+        writer.commit(300);
+        first += 300;
+      }
+      // ...or copying through it
+      writer.write(x.data() + first * channels, (N - first) * channels);
+    }
+
+    AsyncWavReader<double> reader(filename, 1000, 2);
+    ASSERT_REAL(std::abs((long)reader.num_frames() - (long)N), 0, 0);
+    size_t got = 0;
+    for(std::span<const double> block = reader.next(); !block.empty(); block = reader.next()) {
+      for(size_t i=0; i<block.size(); i++)
+        ASSERT_REAL(std::abs(block[i] - x[got * channels + i]), 0, 0);
+      got += block.size() / channels;
+    }
+    ASSERT_REAL(std::abs((long)got - (long)N), 0, 0);
+
+    // Stopped before the end of the file
+    AsyncWavReader<double> partial(filename, 100, 2);
+    partial.next();
+  }
+
+  std::cout << "[rounding and clipping]" << std::endl;
+  {
+    std::vector<double> x = {1.4, -1.6, 2.5, 1e9, -1e9};
+    std::vector<double> ref = {1, -2, 3, 32767, -32768};
+    {
+      std::ofstream fs(filename, std::ios::binary);
+      WavHeader header;
+      init_wav_header(header, 1, 1, 8000, 16, x.size());
+      write_wav_header(fs, header);
+      write_pcm_wav_data(fs, header, x.size(), 2, x);
+    }
+    WavMap wav(filename);
+    std::vector<double> y(x.size());
+    wav.read(0, x.size(), y.data());
+    for(size_t i=0; i<x.size(); i++)
+      ASSERT_REAL(std::abs(y[i] - ref[i]), 0, 0);
+  }
+
+  remove(filename.c_str());
+
+  return 0;
+}
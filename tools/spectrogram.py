@@ -2,6 +2,7 @@
 
 import argparse
 import matplotlib.pyplot as plt
+import numpy as np
 import sys
 
 # line equation, given 2 points (x1,y1) and (x2,y2)
@@ -30,22 +31,29 @@ def freq_to_sample(f, fs, N):
 def sample_to_freq(sample, fs, N):
   return sample * fs / N
 
-# Convert text to array and return number of samples
+# Read the time-frequency matrix written by spectrogram_example
+# (.txt, .npy or .f32 raw float32 with a "SPEC", rows, cols header)
+def load(filename):
+  if filename.endswith(".npy"):
+    return np.load(filename, mmap_mode='r')
+  if filename.endswith(".f32"):
+    magic, rows, cols = np.fromfile(filename, dtype='<u4', count=3)
+    return np.memmap(filename, dtype='<f4', mode='r', offset=12, shape=(rows, cols))
+  return np.loadtxt(filename, ndmin=2)
+
+# Select the time and frequency ranges and return number of samples
 def convert(a, fmin, fmax, tmin, tmax, fs):
   # Input: y-axis = time, x-axis = freq
   # Output: y-axis = freq, x-axis = time
 
-  # Split elements
-  a = [ai.strip().split() for ai in a]
-
-  n_time = len(a)
-  n_freq = len(a[0])
+  n_time = a.shape[0]
+  n_freq = a.shape[1]
   n_tot = n_time * n_freq
 
   # Take positive freq. only
-  a = [ai[0:len(ai) // 2] for ai in a]
+  a = a[:, 0:n_freq // 2]
   # Reverse freq
-  a = [ai[::-1] for ai in a]
+  a = a[:, ::-1]
 
   # Select time
   if(tmax == "max"):
@@ -57,10 +65,8 @@ def convert(a, fmin, fmax, tmin, tmax, fs):
   if(tmin != 0 or tmax != n_time):
     a = a[tmin // n_freq : tmax // n_freq]
 
-  # Convert to float and transpose
-  n_time2 = len(a)
-  n_freq2 = len(a[0])
-  at = [[float(a[j][i]) for j in range(n_time2)] for i in range(n_freq2)]
+  # Transpose
+  at = np.asarray(a, dtype=float).T
 
   print(len(at))
   # Select freq
@@ -86,6 +92,7 @@ parser.add_argument('-f2', default="max", help="End frequency (default:max)")
 parser.add_argument('-i',  default="nearest", help="Interpolation (default: nearest)")
 parser.add_argument('-nt', default=5, help="Number of ticks in time (default: 5)")
 parser.add_argument('-nf', default=5, help="Number of ticks in frequency (default: 5)")
+parser.add_argument('-in', default="spectrogram.txt", dest="input", help="Input file in the tools directory: .txt, .npy or .f32 (default: spectrogram.txt)")
 args = parser.parse_args()
 
 sample_freq = int(args.fs)
@@ -127,8 +134,7 @@ print("Freq ticks: " + str(freq_ticks_num))
 
 # Read file
 cur_dir = '/'.join((__file__.split('/'))[0:-1])
-a_file = open(cur_dir + "/spectrogram.txt", "r")
-a = a_file.readlines()
+a = load(cur_dir + "/" + args.input)
 
 at, time_samples, fft_size = convert(a, f_bottom, f_high, t_bottom, t_high, sample_freq)
 